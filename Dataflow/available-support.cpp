@@ -2,6 +2,8 @@
 // Group: Haojia Sun (haojias), Yikang Cai (dcai)
 ////////////////////////////////////////////////////////////////////////////////
 
+#include "llvm/IR/Constants.h"
+
 #include "available-support.h"
 
 namespace llvm {
@@ -51,113 +53,353 @@ namespace llvm {
 		}
 	}
 
-	// A pretty printer for Expression objects
-	// Feel free to alter in any way you like
-	std::string Expression::toString() const {
-		std::string op = "?";
-		switch (this->op) {
+	// Symbol of a binary operator in printed expressions.
+	static const char* opSymbol(Instruction::BinaryOps op) {
+		switch (op) {
 			case Instruction::Add:
-			case Instruction::FAdd: op = "+"; break;
+			case Instruction::FAdd: return "+";
 			case Instruction::Sub:
-			case Instruction::FSub: op = "-"; break;
+			case Instruction::FSub: return "-";
 			case Instruction::Mul:
-			case Instruction::FMul: op = "*"; break;
+			case Instruction::FMul: return "*";
 			case Instruction::UDiv:
 			case Instruction::FDiv:
-			case Instruction::SDiv: op = "/"; break;
+			case Instruction::SDiv: return "/";
 			case Instruction::URem:
 			case Instruction::FRem:
-			case Instruction::SRem: op = "%"; break;
-			case Instruction::Shl: op = "<<"; break;
+			case Instruction::SRem: return "%";
+			case Instruction::Shl: return "<<";
 			case Instruction::AShr:
-			case Instruction::LShr: op = ">>"; break;
-			case Instruction::And: op = "&"; break;
-			case Instruction::Or: op = "|"; break;
-			case Instruction::Xor: op = "xor"; break;
+			case Instruction::LShr: return ">>";
+			case Instruction::And: return "&";
+			case Instruction::Or: return "|";
+			case Instruction::Xor: return "xor";
+			default: return "?";
 		}
-		return getShortValueName(v1) + " " + op + " " + getShortValueName(v2);
+	}
+
+	// A pretty printer for Expression objects
+	// Feel free to alter in any way you like
+	std::string Expression::toString() const {
+		return getShortValueName(v1) + " " + opSymbol(op) + " " + getShortValueName(v2);
+	}
+
+	std::string Expression::toString(ValueNameTable& names) const {
+		return names.get(v1).str() + " " + opSymbol(op) + " " + names.get(v2).str();
 	}
 
 	// Silly code to print out a set of expressions in a nice
 	// format
-	void printSet(std::vector<Expression> * x) {
+	void printSet(std::vector<Expression> * x, raw_ostream& OS) {
 		bool first = true;
-		outs() << "{";
+		OS << "{";
 
 		for (std::vector<Expression>::iterator it=x->begin(), iend=x->end(); it!=iend; ++it) {
 			if (!first) {
-				outs() << ", ";
+				OS << ", ";
 			}
 			else {
 				first = false;
 			}
-			outs() << (it->toString());
-		}
-		outs() << "}\n";
-	}
-
-	// The following code may be useful for both of your passes:
-	// If you recall, there is no "get the variable on the left
-	// hand side" function in LLVM. Normally this is fine: we
-	// just call getName(). This does not work, however, for
-	// instructions that are publically 'unnamed', but internally
-	// assigned a name like '%0' or '%1'. To get these names, the
-	// following code does some really nasty stuff. It also grabs
-	// raw integer values so our expressions can look a little
-	// cleaner.
-	//
-	// Feel free to improve this code if you want nicer looking
-	// results. For example, ConstantInts are the only pretty
-	// printed Constants.
-	//
-	// Sadly, this code is a great example of not doing things
-	// 'the LLVM way', especially since we're using std::string.
-	// I encourage you to think of a way to make this code nicer
-	// and let me know :)
-	std::string getShortValueName(Value * v) {
-		if (v->getName().str().length() > 0) {
-			return "%" + v->getName().str();
-		}
-		else if (isa<Instruction>(v)) {
-			std::string s = "";
-			raw_string_ostream * strm = new raw_string_ostream(s);
-			v->print(*strm);
-			std::string inst = strm->str();
-			size_t idx1 = inst.find("%");
-			size_t idx2 = inst.find(" ",idx1);
-			if (idx1 != std::string::npos && idx2 != std::string::npos) {
-				return inst.substr(idx1,idx2-idx1);
+			OS << (it->toString());
+		}
+		OS << "}\n";
+	}
+
+	ExpressionCanonicalizer::ExpressionCanonicalizer(Function& F, const PhiAliasResolver& aliases) : aliases_(aliases) {
+		unsigned position = 0;
+		for (Argument& arg : F.args()) {
+			ranks_[&arg] = position++;
+		}
+		for (BasicBlock& BB : F) {
+			for (Instruction& I : BB) {
+				ranks_[&I] = position++;
 			}
-			else {
-				return "\"" + inst + "\"";
+		}
+	}
+
+	unsigned ExpressionCanonicalizer::rank(Value* v) const {
+		auto it = ranks_.find(v);
+		return it == ranks_.end() ? ~0u : it->second;
+	}
+
+	Expression ExpressionCanonicalizer::operator()(Expression e) const {
+		e.v1 = aliases_.lookup(e.v1);
+		e.v2 = aliases_.lookup(e.v2);
+		return order(e);
+	}
+
+	// Bits of an integer or floating-point constant, used to order two constant operands.
+	static Optional<APInt> constantBits(Value* v) {
+		if (ConstantInt* cint = dyn_cast<ConstantInt>(v)) {
+			return cint->getValue();
+		}
+		if (ConstantFP* cfp = dyn_cast<ConstantFP>(v)) {
+			return cfp->getValueAPF().bitcastToAPInt();
+		}
+		return None;
+	}
+
+	Expression ExpressionCanonicalizer::order(Expression e) const {
+		if (!Instruction::isCommutative(e.op)) {
+			return e;
+		}
+		unsigned rank1 = rank(e.v1), rank2 = rank(e.v2);
+		if (rank1 == ~0u && rank2 == ~0u) {
+			// Two constants are ordered by value, so 3 + 5 and 5 + 3 share a bit too. Two other unranked
+			// values keep their order.
+			Optional<APInt> bits1 = constantBits(e.v1), bits2 = constantBits(e.v2);
+			if (bits1 && bits2 && bits2->ult(*bits1)) {
+				std::swap(e.v1, e.v2);
 			}
+		} else if (rank2 < rank1) {
+			std::swap(e.v1, e.v2);
 		}
-		else if (ConstantInt * cint = dyn_cast<ConstantInt>(v)) {
-			std::string s = "";
-			raw_string_ostream * strm = new raw_string_ostream(s);
-			cint->getValue().print(*strm,true);
-			return strm->str();
-		}
-		else if (Argument *arg = dyn_cast<Argument>(v)) {
-			std::string s = "";
-			raw_string_ostream * strm = new raw_string_ostream(s);
-			v->print(*strm);
-			std::string inst = strm->str();
-			size_t idx1 = inst.find("%");
-			if (idx1 != std::string::npos) {
-				return inst.substr(idx1);
+		return e;
+	}
+
+	void AvailablePolicy::genKill(Instruction* I, BitVector& gen, BitVector& kill) const {
+		// GEN: the expression computed by I, unless I or a later instruction of the block redefines an operand
+		if (isa<BinaryOperator>(I)) {
+			Expression e = canonicalize(I);
+			int idx = elementToOffset.lookup(e); // find all expressions in the universal set E
+
+			bool killedLater = false;
+			Value* lhs_var = aliases.lookup(I);
+			// Check if the current LHS variable kills expr, e.g., B = B + C
+			if (aliases.lookup(e.v1) == lhs_var || aliases.lookup(e.v2) == lhs_var) {
+				killedLater = true;
 			}
-			else {
-				return "\"" + inst + "\"";
+
+			// Check if the following LHS variables kill expr, e.g., A = B + C; B = E + D
+			for (auto it = std::next(I->getIterator()); it != I->getParent()->end(); ++it) {
+				Value *lhs2 = aliases.lookup(&*it);
+				if (aliases.lookup(e.v1) == lhs2 || aliases.lookup(e.v2) == lhs2) {
+					killedLater = true;
+					break;
+				}
 			}
 
+			if (!killedLater) {
+				gen.set(idx);
+			}
 		}
-		else {
-			std::string s = "";
-			raw_string_ostream * strm = new raw_string_ostream(s);
-			v->print(*strm);
-			std::string inst = strm->str();
-			return "\"" + inst + "\"";
+
+		// KILL: the expressions in the universal set E that use the LHS of I
+		auto uses = killIndex.find(aliases.lookup(I));
+		if (uses != killIndex.end()) {
+			for (int idx : uses->second) {
+				kill.set(idx);
+			}
 		}
 	}
+
+	DataflowProblem makeAvailableProblem(AvailablePolicy policy) {
+		DataflowProblem problem;
+		problem.name = "available";
+		problem.forward = AvailablePolicy::forward;
+		problem.meet = DataflowProblem::Meet::Intersection;
+		problem.boundaryValue = AvailablePolicy::boundaryValue();
+		problem.numElements = policy.elementToOffset.size();
+		problem.genKill = [policy](Instruction* I, BitVector& gen, BitVector& kill) {
+			policy.genKill(I, gen, kill);
+		};
+		return problem;
+	}
+
+	struct AvailableExpressionsInfo::State {
+		explicit State(Function& F);
+		~State();
+
+		Function& F;
+		// Wall time of the phases run so far, reported by emitFunctionMetrics() when the state is released
+		PhaseTimes times;
+		// Alias sets of PHI-connected values, frozen into a member -> representative table
+		PhiAliasResolver aliases;
+		ExpressionCanonicalizer canonicalize;
+		// Every BinaryOperator of F in program order, as printed
+		std::vector<Expression> expressions;
+		// Canonical expression <-> bit offset
+		DenseMap<Expression, int> elementToOffset;
+		DenseMap<int, Expression> offsetToElement;
+		// Inverted index: representative operand -> offsets of the expressions that use it,
+		// so killing a definition only touches the expressions of the defined value.
+		DenseMap<Value*, SmallVector<int, 4>> killIndex;
+		DataflowSolver<AvailablePolicy> solver;
+	};
+
+	DenseMap<Expression, int> createExpressionOffsets(Function& F, const ExpressionCanonicalizer& canonicalize) {
+		return DataflowAnalysis<Expression>::createBitVectorOffsetMap(F,
+			[&](const Instruction* I) -> std::vector<Expression> {
+				std::vector<Expression> elems;
+				if (isa<BinaryOperator>(I)) {
+					elems.push_back(canonicalize((Instruction*)I));
+				}
+				return elems;
+			});
+	}
+
+	DenseMap<Value*, SmallVector<int, 4>> createKillIndex(const DenseMap<Expression, int>& elementToOffset) {
+		DenseMap<Value*, SmallVector<int, 4>> killIndex;
+		for (auto& [e, idx] : elementToOffset) {
+			killIndex[e.v1].push_back(idx);
+			if (e.v2 != e.v1) {
+				killIndex[e.v2].push_back(idx);
+			}
+		}
+		return killIndex;
+	}
+
+	AvailableExpressionsInfo::State::State(Function& F)
+		: F(F),
+		aliases(timePhase(DataflowPhase::AliasResolution, times, [&] { return PhiAliasResolver(F); })),
+		canonicalize(timePhase(DataflowPhase::OffsetMap, times, [&] { return ExpressionCanonicalizer(F, aliases); })),
+		elementToOffset(timePhase(DataflowPhase::OffsetMap, times, [&] { return createExpressionOffsets(F, canonicalize); })),
+		solver(AvailablePolicy(canonicalize, elementToOffset, killIndex), elementToOffset.size()) {
+		{
+			PhaseRegion region(DataflowPhase::OffsetMap, &times);
+			for (auto &B : F)
+				for (auto &I : B)
+					// We only care about available expressions for BinaryOperators
+					if (BinaryOperator *BI = dyn_cast<BinaryOperator>(&I))
+						// Create a new Expression to capture the RHS of the BinaryOperator
+						expressions.push_back(Expression(BI));
+
+			for (auto& [e, idx] : elementToOffset) {
+				offsetToElement[idx] = e;
+			}
+			killIndex = createKillIndex(elementToOffset);
+		}
+
+		// forward, intersection meet, entry = empty set, others = universal set
+		PhaseRegion region(DataflowPhase::Solve, &times);
+		solver.setIterationStrategy(DataflowStrategy);
+		solver.setResultMode(DataflowResultMode, DataflowCheckpointInterval);
+		solver.setStateRepresentation(DataflowStates);
+		solver.solve(F);
+	}
+
+	AvailableExpressionsInfo::State::~State() {
+		emitFunctionMetrics("available", F, solver.getStats(), times);
+	}
+
+	AvailableExpressionsInfo::AvailableExpressionsInfo(Function& F) : state_(std::make_unique<State>(F)) {}
+	AvailableExpressionsInfo::AvailableExpressionsInfo(AvailableExpressionsInfo&&) = default;
+	AvailableExpressionsInfo& AvailableExpressionsInfo::operator=(AvailableExpressionsInfo&&) = default;
+	AvailableExpressionsInfo::~AvailableExpressionsInfo() = default;
+
+	unsigned AvailableExpressionsInfo::getNumExpressions() const {
+		return state_->elementToOffset.size();
+	}
+
+	const Expression& AvailableExpressionsInfo::getExpression(unsigned offset) const {
+		auto it = state_->offsetToElement.find(offset);
+		assert(it != state_->offsetToElement.end() && "offset out of range");
+		return it->second;
+	}
+
+	int AvailableExpressionsInfo::getOffset(const Expression& e) const {
+		auto it = state_->elementToOffset.find(state_->canonicalize(e));
+		return it == state_->elementToOffset.end() ? -1 : it->second;
+	}
+
+	Optional<BitVector> AvailableExpressionsInfo::getAvailableAfter(Instruction* I) const {
+		return state_->solver.lookupState(I);
+	}
+
+	Optional<BitVector> AvailableExpressionsInfo::getAvailableBefore(Instruction* I) const {
+		if (Instruction* prev = I->getPrevNode()) {
+			return getAvailableAfter(prev);
+		}
+		const StateStore& states = state_->solver.getStates();
+		int block = states.blockIndex(I->getParent());
+		if (block < 0) {
+			return None;
+		}
+		return states.inputState(block).toBitVector();
+	}
+
+	bool AvailableExpressionsInfo::isAvailableAfter(const Expression& e, Instruction* I) const {
+		int offset = getOffset(e);
+		if (offset < 0) {
+			return false;
+		}
+		Optional<BitVector> available = getAvailableAfter(I);
+		return available && available->test(offset);
+	}
+
+	const SolverStats& AvailableExpressionsInfo::getStats() const {
+		return state_->solver.getStats();
+	}
+
+	const ExpressionCanonicalizer& AvailableExpressionsInfo::getCanonicalizer() const {
+		return state_->canonicalize;
+	}
+
+	void AvailableExpressionsInfo::print(raw_ostream& OS) const {
+		ResultEmitter emitter(OS, ResultFormat::Text);
+		emit(emitter);
+	}
+
+	void AvailableExpressionsInfo::emit(ResultEmitter& emitter) const {
+		if (emitter.format() == ResultFormat::Silent) {
+			return;
+		}
+		PhaseRegion region(DataflowPhase::ResultEmission, &state_->times);
+		ValueNameTable names(state_->F);
+		std::vector<std::string> elementStrings(getNumExpressions());
+		for (auto& [idx, e] : state_->offsetToElement) {
+			elementStrings[idx] = e.toString(names);
+		}
+		std::vector<StringRef> elementNames(elementStrings.begin(), elementStrings.end());
+		if (!emitter.isText()) {
+			emitter.writeFunction("available", "after", state_->F, elementNames, getStats(),
+				[&](const Instruction& I) { return getAvailableAfter(const_cast<Instruction*>(&I)); });
+			return;
+		}
+
+		// Print out the expressions used in the function
+		raw_ostream& OS = emitter.text();
+		OS << "Expressions used by this function:\n";
+		OS << "{";
+		for (size_t i = 0; i < state_->expressions.size(); ++i) {
+			if (i) OS << ", ";
+			OS << state_->expressions[i].toString(names);
+		}
+		OS << "}\n";
+		printSolverStats(getStats(), OS);
+
+		// Iterating over all instructions in the basic blocks, print the OUT set of each instruction.
+		OS<<"-------Result Start----------\n";
+		OS<<"----Basic Block Boundary----\n";
+		for(auto& bb : state_->F){
+			for(auto& inst : bb){
+				Optional<BitVector> out = getAvailableAfter(&inst);
+				names.printInstruction(inst, OS);
+				OS<<"\n";
+				if(out){
+					emitter.writeSet(*out, elementNames);
+				}
+			}
+			OS<<"----Basic Block Boundary----\n";
+		}
+	}
+
+	bool AvailableExpressionsInfo::invalidate(Function& F, const PreservedAnalyses& PA,
+		FunctionAnalysisManager::Invalidator&) {
+		auto PAC = PA.getChecker<AvailableExpressionsAnalysis>();
+		return !PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>();
+	}
+
+	AnalysisKey AvailableExpressionsAnalysis::Key;
+
+	AvailableExpressionsInfo AvailableExpressionsAnalysis::run(Function& F, FunctionAnalysisManager&) {
+		return AvailableExpressionsInfo(F);
+	}
+
+	PreservedAnalyses AvailableExpressionsPrinterPass::run(Function& F, FunctionAnalysisManager& FAM) {
+		ResultEmitter emitter(OS, DataflowOutput);
+		FAM.getResult<AvailableExpressionsAnalysis>(F).emit(emitter);
+		return PreservedAnalyses::all();
+	}
 }
@@ -5,19 +5,24 @@
 #ifndef __AVAILABLE_SUPPORT_H__
 #define __AVAILABLE_SUPPORT_H__
 
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "llvm/ADT/Hashing.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/Instructions.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
 
-namespace llvm {
-	std::string getShortValueName(Value * v);
+#include "dataflow.h"
+#include "phi-alias.h"
+#include "result-emitter.h"
 
+namespace llvm {
 	class Expression {
 		public:
 			Value * v1;
@@ -28,6 +33,8 @@ namespace llvm {
 			bool operator== (const Expression &e2) const;
 			bool operator< (const Expression &e2) const;
 			std::string toString() const;
+			// Same as toString(), with the operand names interned in names.
+			std::string toString(ValueNameTable& names) const;
 	};
 
 	template<> struct DenseMapInfo<Expression> {
@@ -38,14 +45,133 @@ namespace llvm {
 			return Expression((Instruction*)-2);
 		}
 		static unsigned getHashValue(const Expression &E) {
-			return (uintptr_t)E.v1 ^ ((uintptr_t)E.v2 << 4) ^ E.op;
+			return hash_combine(E.v1, E.v2, E.op);
 		}
 		static bool isEqual(const Expression &LHS, const Expression &RHS) {
 			return LHS == RHS;
 		}
 	};
 
-	void printSet(std::vector<Expression> * x);
+	void printSet(std::vector<Expression> * x, raw_ostream& OS = outs());
+
+	// Canonical form of the expressions of one function, so that equal computations share one bit.
+	// Operands are replaced by their PHI alias representative. The operands of a commutative opcode are
+	// then ordered by program position: arguments first, then instructions, then constants. Constants are
+	// uniqued by LLVM, so ordering them last is all the normalization they need, and a+b, b+a and 1+a, a+1
+	// each become one expression.
+	class ExpressionCanonicalizer {
+		public:
+			ExpressionCanonicalizer(Function& F, const PhiAliasResolver& aliases);
+
+			Expression operator()(Expression e) const;
+			Expression operator()(Instruction* I) const { return (*this)(Expression(I)); }
+			// Only order the operands of e, keeping the values themselves. Commutative operands are ordered by
+			// program position, then constants by value.
+			Expression order(Expression e) const;
+
+			const PhiAliasResolver& getAliases() const { return aliases_; }
+
+		private:
+			// Program position of an argument or instruction of F; other values rank after all of them.
+			unsigned rank(Value* v) const;
+
+			const PhiAliasResolver& aliases_;
+			DenseMap<Value*, unsigned> ranks_;
+	};
+
+	// Available expressions as a solver policy, so the gen/kill function is inlined into the solver.
+	// OUT = (IN - KILL) ∪ GEN; the solver composes the sets into one summary per basic block before solving.
+	struct AvailablePolicy : IntersectionMeetPolicy {
+		static constexpr bool forward = true;
+		static constexpr TransferKind transferKind = TransferKind::GenKill;
+		static constexpr bool boundaryValue() { return false; }
+
+		AvailablePolicy(const ExpressionCanonicalizer& canonicalize, const DenseMap<Expression, int>& elementToOffset,
+			const DenseMap<Value*, SmallVector<int, 4>>& killIndex)
+			: canonicalize(canonicalize), aliases(canonicalize.getAliases()), elementToOffset(elementToOffset),
+			killIndex(killIndex) {}
+
+		void genKill(Instruction* I, BitVector& gen, BitVector& kill) const;
+
+		const ExpressionCanonicalizer& canonicalize;
+		const PhiAliasResolver& aliases;
+		const DenseMap<Expression, int>& elementToOffset;
+		// Inverted index: representative operand -> offsets of the expressions that use it
+		const DenseMap<Value*, SmallVector<int, 4>>& killIndex;
+	};
+
+	// Map every BinaryOperator of F to the bit offset of its canonical expression.
+	DenseMap<Expression, int> createExpressionOffsets(Function& F, const ExpressionCanonicalizer& canonicalize);
+	// Inverted index of AvailablePolicy: representative operand -> offsets of the expressions that use it.
+	DenseMap<Value*, SmallVector<int, 4>> createKillIndex(const DenseMap<Expression, int>& elementToOffset);
+
+	// Available expressions as a forward problem of a fused bundle (fused-dataflow.h). The canonicalizer,
+	// its alias sets and the maps policy refers to must outlive the problem.
+	DataflowProblem makeAvailableProblem(AvailablePolicy policy);
+
+	// Available expressions of one function, solved once on construction and queried afterwards.
+	// Expressions are canonicalized by an ExpressionCanonicalizer over the PHI alias sets of the function.
+	class AvailableExpressionsInfo {
+		public:
+			explicit AvailableExpressionsInfo(Function& F);
+			AvailableExpressionsInfo(AvailableExpressionsInfo&&);
+			AvailableExpressionsInfo& operator=(AvailableExpressionsInfo&&);
+			~AvailableExpressionsInfo();
+
+			// Number of distinct expressions, and the expression at a bit offset of the states.
+			unsigned getNumExpressions() const;
+			const Expression& getExpression(unsigned offset) const;
+			// Bit offset of the canonical form of e, or -1 if F does not compute it.
+			int getOffset(const Expression& e) const;
+
+			// Expressions available after I, or None if I is unreachable.
+			Optional<BitVector> getAvailableAfter(Instruction* I) const;
+			// Expressions available right before I: the state after the previous instruction, or the input
+			// of I's block for its first instruction. None if I is unreachable.
+			Optional<BitVector> getAvailableBefore(Instruction* I) const;
+			bool isAvailableAfter(const Expression& e, Instruction* I) const;
+
+			const SolverStats& getStats() const;
+			const ExpressionCanonicalizer& getCanonicalizer() const;
+
+			// Print the expressions of the function, the solver counters and the availability after each
+			// instruction, in the format of the -available pass.
+			void print(raw_ostream& OS) const;
+			// Write the results in the format of emitter: print() for text, else one record of the
+			// availability after each instruction.
+			void emit(ResultEmitter& emitter) const;
+
+			// Results point into the IR, so they are dropped unless the analysis or all function analyses
+			// are preserved.
+			bool invalidate(Function& F, const PreservedAnalyses& PA, FunctionAnalysisManager::Invalidator&);
+
+		private:
+			// Kept behind a pointer: the solver policy refers to the other members, so they must not move.
+			struct State;
+			std::unique_ptr<State> state_;
+	};
+
+	// New pass manager analysis: opt -passes='require<available-expressions>' or any pass calling
+	// FAM.getResult<AvailableExpressionsAnalysis>(F). The result is cached until invalidated.
+	class AvailableExpressionsAnalysis : public AnalysisInfoMixin<AvailableExpressionsAnalysis> {
+		public:
+			using Result = AvailableExpressionsInfo;
+			Result run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			friend AnalysisInfoMixin<AvailableExpressionsAnalysis>;
+			static AnalysisKey Key;
+	};
+
+	// opt -passes='print<available-expressions>': prints the cached AvailableExpressionsAnalysis result.
+	class AvailableExpressionsPrinterPass : public PassInfoMixin<AvailableExpressionsPrinterPass> {
+		public:
+			explicit AvailableExpressionsPrinterPass(raw_ostream& OS) : OS(OS) {}
+			PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			raw_ostream& OS;
+	};
 }
 
 #endif
@@ -0,0 +1,296 @@
+// 15-745 Assignment 2: bitset-kernels.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include "bitset-kernels.h"
+
+#include "llvm/ADT/SmallVector.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BITSET_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace llvm {
+namespace bitkernels {
+	namespace {
+		// Table of kernel implementations for one instruction set.
+		struct KernelTable {
+			const char* name;
+			void (*andNot)(Word*, const Word*, size_t);
+			void (*orInto)(Word*, const Word*, size_t);
+			void (*andInto)(Word*, const Word*, size_t);
+			void (*transfer)(Word*, const Word*, const Word*, size_t);
+			void (*meetUnion)(Word*, const Word* const*, size_t, size_t);
+			void (*meetIntersection)(Word*, const Word* const*, size_t, size_t);
+		};
+
+		// Portable word-at-a-time kernels. Also used for the tail words of the vector kernels.
+		void andNotScalar(Word* dst, const Word* src, size_t n) {
+			for (size_t i = 0; i < n; ++i) dst[i] &= ~src[i];
+		}
+
+		void orIntoScalar(Word* dst, const Word* src, size_t n) {
+			for (size_t i = 0; i < n; ++i) dst[i] |= src[i];
+		}
+
+		void andIntoScalar(Word* dst, const Word* src, size_t n) {
+			for (size_t i = 0; i < n; ++i) dst[i] &= src[i];
+		}
+
+		void transferScalar(Word* state, const Word* kill, const Word* gen, size_t n) {
+			for (size_t i = 0; i < n; ++i) state[i] = (state[i] & ~kill[i]) | gen[i];
+		}
+
+		void meetUnionScalar(Word* dst, const Word* const* srcs, size_t count, size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				Word w = dst[i];
+				for (size_t s = 0; s < count; ++s) w |= srcs[s][i];
+				dst[i] = w;
+			}
+		}
+
+		void meetIntersectionScalar(Word* dst, const Word* const* srcs, size_t count, size_t n) {
+			for (size_t i = 0; i < n; ++i) {
+				Word w = dst[i];
+				for (size_t s = 0; s < count; ++s) w &= srcs[s][i];
+				dst[i] = w;
+			}
+		}
+
+		const KernelTable scalarKernels = {
+			"scalar", andNotScalar, orIntoScalar, andIntoScalar,
+			transferScalar, meetUnionScalar, meetIntersectionScalar
+		};
+
+#ifdef BITSET_KERNELS_X86
+		// SSE2 kernels, 128 bits per step.
+		constexpr size_t SSE2Words = sizeof(__m128i) / sizeof(Word);
+
+		__attribute__((target("sse2")))
+		void andNotSSE2(Word* dst, const Word* src, size_t n) {
+			size_t i = 0;
+			for (; i + SSE2Words <= n; i += SSE2Words) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_andnot_si128(s, d));
+			}
+			andNotScalar(dst + i, src + i, n - i);
+		}
+
+		__attribute__((target("sse2")))
+		void orIntoSSE2(Word* dst, const Word* src, size_t n) {
+			size_t i = 0;
+			for (; i + SSE2Words <= n; i += SSE2Words) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_or_si128(d, s));
+			}
+			orIntoScalar(dst + i, src + i, n - i);
+		}
+
+		__attribute__((target("sse2")))
+		void andIntoSSE2(Word* dst, const Word* src, size_t n) {
+			size_t i = 0;
+			for (; i + SSE2Words <= n; i += SSE2Words) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(d, s));
+			}
+			andIntoScalar(dst + i, src + i, n - i);
+		}
+
+		__attribute__((target("sse2")))
+		void transferSSE2(Word* state, const Word* kill, const Word* gen, size_t n) {
+			size_t i = 0;
+			for (; i + SSE2Words <= n; i += SSE2Words) {
+				__m128i s = _mm_loadu_si128((const __m128i*)(state + i));
+				__m128i k = _mm_loadu_si128((const __m128i*)(kill + i));
+				__m128i g = _mm_loadu_si128((const __m128i*)(gen + i));
+				_mm_storeu_si128((__m128i*)(state + i), _mm_or_si128(_mm_andnot_si128(k, s), g));
+			}
+			transferScalar(state + i, kill + i, gen + i, n - i);
+		}
+
+		__attribute__((target("sse2")))
+		void meetUnionSSE2(Word* dst, const Word* const* srcs, size_t count, size_t n) {
+			size_t i = 0;
+			for (; i + SSE2Words <= n; i += SSE2Words) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				for (size_t s = 0; s < count; ++s) {
+					d = _mm_or_si128(d, _mm_loadu_si128((const __m128i*)(srcs[s] + i)));
+				}
+				_mm_storeu_si128((__m128i*)(dst + i), d);
+			}
+			for (; i < n; ++i) {
+				for (size_t s = 0; s < count; ++s) dst[i] |= srcs[s][i];
+			}
+		}
+
+		__attribute__((target("sse2")))
+		void meetIntersectionSSE2(Word* dst, const Word* const* srcs, size_t count, size_t n) {
+			size_t i = 0;
+			for (; i + SSE2Words <= n; i += SSE2Words) {
+				__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+				for (size_t s = 0; s < count; ++s) {
+					d = _mm_and_si128(d, _mm_loadu_si128((const __m128i*)(srcs[s] + i)));
+				}
+				_mm_storeu_si128((__m128i*)(dst + i), d);
+			}
+			for (; i < n; ++i) {
+				for (size_t s = 0; s < count; ++s) dst[i] &= srcs[s][i];
+			}
+		}
+
+		const KernelTable sse2Kernels = {
+			"sse2", andNotSSE2, orIntoSSE2, andIntoSSE2,
+			transferSSE2, meetUnionSSE2, meetIntersectionSSE2
+		};
+
+		// AVX2 kernels, 256 bits per step.
+		constexpr size_t AVX2Words = sizeof(__m256i) / sizeof(Word);
+
+		__attribute__((target("avx2")))
+		void andNotAVX2(Word* dst, const Word* src, size_t n) {
+			size_t i = 0;
+			for (; i + AVX2Words <= n; i += AVX2Words) {
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+				_mm256_storeu_si256((__m256i*)(dst + i), _mm256_andnot_si256(s, d));
+			}
+			andNotScalar(dst + i, src + i, n - i);
+		}
+
+		__attribute__((target("avx2")))
+		void orIntoAVX2(Word* dst, const Word* src, size_t n) {
+			size_t i = 0;
+			for (; i + AVX2Words <= n; i += AVX2Words) {
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+				_mm256_storeu_si256((__m256i*)(dst + i), _mm256_or_si256(d, s));
+			}
+			orIntoScalar(dst + i, src + i, n - i);
+		}
+
+		__attribute__((target("avx2")))
+		void andIntoAVX2(Word* dst, const Word* src, size_t n) {
+			size_t i = 0;
+			for (; i + AVX2Words <= n; i += AVX2Words) {
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				__m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+				_mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(d, s));
+			}
+			andIntoScalar(dst + i, src + i, n - i);
+		}
+
+		__attribute__((target("avx2")))
+		void transferAVX2(Word* state, const Word* kill, const Word* gen, size_t n) {
+			size_t i = 0;
+			for (; i + AVX2Words <= n; i += AVX2Words) {
+				__m256i s = _mm256_loadu_si256((const __m256i*)(state + i));
+				__m256i k = _mm256_loadu_si256((const __m256i*)(kill + i));
+				__m256i g = _mm256_loadu_si256((const __m256i*)(gen + i));
+				_mm256_storeu_si256((__m256i*)(state + i), _mm256_or_si256(_mm256_andnot_si256(k, s), g));
+			}
+			transferScalar(state + i, kill + i, gen + i, n - i);
+		}
+
+		__attribute__((target("avx2")))
+		void meetUnionAVX2(Word* dst, const Word* const* srcs, size_t count, size_t n) {
+			size_t i = 0;
+			for (; i + AVX2Words <= n; i += AVX2Words) {
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				for (size_t s = 0; s < count; ++s) {
+					d = _mm256_or_si256(d, _mm256_loadu_si256((const __m256i*)(srcs[s] + i)));
+				}
+				_mm256_storeu_si256((__m256i*)(dst + i), d);
+			}
+			for (; i < n; ++i) {
+				for (size_t s = 0; s < count; ++s) dst[i] |= srcs[s][i];
+			}
+		}
+
+		__attribute__((target("avx2")))
+		void meetIntersectionAVX2(Word* dst, const Word* const* srcs, size_t count, size_t n) {
+			size_t i = 0;
+			for (; i + AVX2Words <= n; i += AVX2Words) {
+				__m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+				for (size_t s = 0; s < count; ++s) {
+					d = _mm256_and_si256(d, _mm256_loadu_si256((const __m256i*)(srcs[s] + i)));
+				}
+				_mm256_storeu_si256((__m256i*)(dst + i), d);
+			}
+			for (; i < n; ++i) {
+				for (size_t s = 0; s < count; ++s) dst[i] &= srcs[s][i];
+			}
+		}
+
+		const KernelTable avx2Kernels = {
+			"avx2", andNotAVX2, orIntoAVX2, andIntoAVX2,
+			transferAVX2, meetUnionAVX2, meetIntersectionAVX2
+		};
+#endif
+
+		// Pick the widest implementation the CPU supports, once per process.
+		const KernelTable& kernels() {
+			static const KernelTable& table = []() -> const KernelTable& {
+#ifdef BITSET_KERNELS_X86
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx2")) return avx2Kernels;
+				if (__builtin_cpu_supports("sse2")) return sse2Kernels;
+#endif
+				return scalarKernels;
+			}();
+			return table;
+		}
+	}
+
+	void andNot(Word* dst, const Word* src, size_t numWords) {
+		kernels().andNot(dst, src, numWords);
+	}
+
+	void orInto(Word* dst, const Word* src, size_t numWords) {
+		kernels().orInto(dst, src, numWords);
+	}
+
+	void andInto(Word* dst, const Word* src, size_t numWords) {
+		kernels().andInto(dst, src, numWords);
+	}
+
+	void transfer(Word* state, const Word* kill, const Word* gen, size_t numWords) {
+		kernels().transfer(state, kill, gen, numWords);
+	}
+
+	void meetUnion(Word* dst, const Word* const* srcs, size_t count, size_t numWords) {
+		kernels().meetUnion(dst, srcs, count, numWords);
+	}
+
+	void meetIntersection(Word* dst, const Word* const* srcs, size_t count, size_t numWords) {
+		kernels().meetIntersection(dst, srcs, count, numWords);
+	}
+
+	const char* kernelName() {
+		return kernels().name;
+	}
+
+	void meetUnion(BitVector& dst, ArrayRef<const BitVector*> srcs) {
+		if (dst.size() == 0 || srcs.empty()) return;
+		SmallVector<const Word*, 8> srcWords;
+		for (const BitVector* src : srcs) {
+			assert(src->size() == dst.size());
+			srcWords.push_back(words(*src));
+		}
+		meetUnion(words(dst), srcWords.data(), srcWords.size(), numWords(dst));
+	}
+
+	void meetIntersection(BitVector& dst, ArrayRef<const BitVector*> srcs) {
+		if (dst.size() == 0 || srcs.empty()) return;
+		SmallVector<const Word*, 8> srcWords;
+		for (const BitVector* src : srcs) {
+			assert(src->size() == dst.size());
+			srcWords.push_back(words(*src));
+		}
+		meetIntersection(words(dst), srcWords.data(), srcWords.size(), numWords(dst));
+	}
+}
+}
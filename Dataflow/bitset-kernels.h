@@ -0,0 +1,79 @@
+// 15-745 Assignment 2: bitset-kernels.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BITSET_KERNELS_H__
+#define __BITSET_KERNELS_H__
+
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+
+namespace llvm {
+namespace bitkernels {
+	// Kernels work on raw word arrays so they can be used both on BitVector storage and on
+	// states kept outside of a BitVector. All arrays passed to one call hold the same number of words.
+	using Word = uintptr_t;
+	static_assert(std::is_same<ArrayRef<Word>, decltype(std::declval<BitVector>().getData())>::value,
+		"bitset kernels must use the BitVector word type");
+	constexpr unsigned WordBits = sizeof(Word) * CHAR_BIT;
+
+	// dst &= ~src
+	void andNot(Word* dst, const Word* src, size_t numWords);
+	// dst |= src
+	void orInto(Word* dst, const Word* src, size_t numWords);
+	// dst &= src
+	void andInto(Word* dst, const Word* src, size_t numWords);
+	// state = (state & ~kill) | gen
+	void transfer(Word* state, const Word* kill, const Word* gen, size_t numWords);
+	// dst |= srcs[0] | srcs[1] | ... | srcs[count - 1]
+	void meetUnion(Word* dst, const Word* const* srcs, size_t count, size_t numWords);
+	// dst &= srcs[0] & srcs[1] & ... & srcs[count - 1]
+	void meetIntersection(Word* dst, const Word* const* srcs, size_t count, size_t numWords);
+
+	// Name of the implementation picked for this CPU: "avx2", "sse2" or "scalar".
+	const char* kernelName();
+
+	// Number of words backing a BitVector.
+	inline size_t numWords(const BitVector& bv) {
+		return (bv.size() + WordBits - 1) / WordBits;
+	}
+
+	// BitVector only exposes its words read-only. The kernels keep the unused tail bits cleared,
+	// so writing through them in place is safe.
+	inline Word* words(BitVector& bv) {
+		return const_cast<Word*>(bv.getData().data());
+	}
+
+	inline const Word* words(const BitVector& bv) {
+		return bv.getData().data();
+	}
+
+	// In-place BitVector forms of the kernels above.
+	inline void andNot(BitVector& dst, const BitVector& src) {
+		assert(dst.size() == src.size());
+		if (dst.size() != 0) andNot(words(dst), words(src), numWords(dst));
+	}
+
+	inline void orInto(BitVector& dst, const BitVector& src) {
+		assert(dst.size() == src.size());
+		if (dst.size() != 0) orInto(words(dst), words(src), numWords(dst));
+	}
+
+	inline void transfer(BitVector& state, const BitVector& kill, const BitVector& gen) {
+		assert(state.size() == kill.size() && state.size() == gen.size());
+		if (state.size() != 0) transfer(words(state), words(kill), words(gen), numWords(state));
+	}
+
+	void meetUnion(BitVector& dst, ArrayRef<const BitVector*> srcs);
+	void meetIntersection(BitVector& dst, ArrayRef<const BitVector*> srcs);
+}
+}
+
+#endif
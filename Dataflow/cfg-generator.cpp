@@ -0,0 +1,290 @@
+// 15-745 Assignment 2: cfg-generator.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "cfg-generator.h"
+
+namespace llvm {
+	namespace {
+		// Builds the function region by region. vars_ holds the current SSA value of every variable; regions
+		// with several paths restore it where the paths join, through PHIs or the values dominating the region.
+		class CFGGenerator {
+			public:
+				CFGGenerator(Module& M, const CFGShape& shape, StringRef name);
+				Function* run();
+
+			private:
+				using Variables = std::vector<Value*>;
+
+				BasicBlock* newBlock(const char* name);
+				bool chance(double p) { return std::uniform_real_distribution<double>(0, 1)(rng_) < p; }
+				unsigned below(unsigned n) { return std::uniform_int_distribution<unsigned>(0, n - 1)(rng_); }
+				Value* pickVariable() { return vars_[below(vars_.size())]; }
+
+				void emitExpressions();
+				Value* emitCondition();
+				// Emit regions until the block budget is spent (depth 0) or count regions were emitted.
+				void genSequence(unsigned depth, unsigned count);
+				void genRegion(unsigned depth);
+				void genLoop(unsigned depth);
+				void genSwitch(unsigned depth);
+				void genIrreducible();
+				// Set vars_ for join, whose predecessors end with the given variable values. Variables with
+				// different incoming values get a PHI with probability phiDensity, else fall back to dominating.
+				void joinVariables(BasicBlock* join, ArrayRef<std::pair<BasicBlock*, Variables>> incoming,
+					const Variables& dominating);
+
+				const CFGShape& shape_;
+				Function* F_;
+				IRBuilder<> B_;
+				std::mt19937 rng_;
+				unsigned blocksLeft_;
+				unsigned irreducibleLeft_;
+				// Loop trip count, the last argument.
+				Value* bound_ = nullptr;
+				Variables vars_;
+		};
+
+		CFGGenerator::CFGGenerator(Module& M, const CFGShape& shape, StringRef name)
+			: shape_(shape), B_(M.getContext()), rng_(shape.seed), blocksLeft_(shape.blocks),
+			irreducibleLeft_(shape.irreducible) {
+			assert(shape.variables > 0 && "need at least one variable");
+			Type* i32 = B_.getInt32Ty();
+			std::vector<Type*> params(shape.variables + 1, i32);
+			F_ = Function::Create(FunctionType::get(i32, params, false), GlobalValue::ExternalLinkage, name, M);
+		}
+
+		BasicBlock* CFGGenerator::newBlock(const char* name) {
+			if (blocksLeft_ > 0) {
+				blocksLeft_--;
+			}
+			return BasicBlock::Create(F_->getContext(), name, F_);
+		}
+
+		void CFGGenerator::emitExpressions() {
+			static const Instruction::BinaryOps ops[] = {
+				Instruction::Add, Instruction::Sub, Instruction::Mul, Instruction::Xor, Instruction::And, Instruction::Or
+			};
+			for (unsigned e = 0; e < shape_.expressions; ++e) {
+				Value* lhs = pickVariable();
+				Value* rhs = chance(0.2) ? B_.getInt32(below(16) + 1) : pickVariable();
+				Value* result = B_.CreateBinOp(ops[below(array_lengthof(ops))], lhs, rhs);
+				// Half of the results redefine a variable, which kills the expressions using its old value.
+				if (chance(0.5)) {
+					vars_[below(vars_.size())] = result;
+				}
+			}
+		}
+
+		Value* CFGGenerator::emitCondition() {
+			return B_.CreateICmpSLT(pickVariable(), pickVariable());
+		}
+
+		void CFGGenerator::genSequence(unsigned depth, unsigned count) {
+			for (unsigned i = 0; depth == 0 ? blocksLeft_ > 0 : i < count && blocksLeft_ > 0; ++i) {
+				genRegion(depth);
+			}
+		}
+
+		void CFGGenerator::genRegion(unsigned depth) {
+			// Keep enough budget to place the remaining irreducible regions.
+			if (irreducibleLeft_ > 0 && blocksLeft_ >= 3 && (blocksLeft_ <= 3 * irreducibleLeft_ + 3 || chance(0.25))) {
+				genIrreducible();
+				return;
+			}
+			std::vector<unsigned> kinds = {0};
+			if (depth < shape_.loopDepth && blocksLeft_ >= 3) {
+				kinds.push_back(1);
+			}
+			if (shape_.switchFanout > 0 && blocksLeft_ >= shape_.switchFanout + 2) {
+				kinds.push_back(2);
+			}
+			switch (kinds[below(kinds.size())]) {
+				case 0: {
+					// Straight-line block
+					BasicBlock* next = newBlock("bb");
+					B_.CreateBr(next);
+					B_.SetInsertPoint(next);
+					emitExpressions();
+					break;
+				}
+				case 1:
+					genLoop(depth);
+					break;
+				case 2:
+					genSwitch(depth);
+					break;
+			}
+		}
+
+		// pre -> header -> body ... latch -> header, header -> exit
+		void CFGGenerator::genLoop(unsigned depth) {
+			BasicBlock* pre = B_.GetInsertBlock();
+			BasicBlock* header = newBlock("loop");
+			BasicBlock* body = newBlock("body");
+			BasicBlock* exit = newBlock("exit");
+			B_.CreateBr(header);
+
+			B_.SetInsertPoint(header);
+			PHINode* iv = B_.CreatePHI(B_.getInt32Ty(), 2, "iv");
+			iv->addIncoming(B_.getInt32(0), pre);
+			std::vector<PHINode*> phis(vars_.size(), nullptr);
+			for (unsigned i = 0; i < vars_.size(); ++i) {
+				if (chance(shape_.phiDensity)) {
+					phis[i] = B_.CreatePHI(B_.getInt32Ty(), 2);
+					phis[i]->addIncoming(vars_[i], pre);
+					vars_[i] = phis[i];
+				}
+			}
+			Variables atHeader = vars_;
+			B_.CreateCondBr(B_.CreateICmpSLT(iv, bound_), body, exit);
+
+			B_.SetInsertPoint(body);
+			emitExpressions();
+			genSequence(depth + 1, below(3));
+			BasicBlock* latch = B_.GetInsertBlock();
+			iv->addIncoming(B_.CreateAdd(iv, B_.getInt32(1)), latch);
+			for (unsigned i = 0; i < vars_.size(); ++i) {
+				if (phis[i]) {
+					phis[i]->addIncoming(vars_[i], latch);
+				}
+			}
+			B_.CreateBr(header);
+
+			// Only the header dominates the exit.
+			B_.SetInsertPoint(exit);
+			vars_ = atHeader;
+			emitExpressions();
+		}
+
+		// A switch over a variable with switchFanout cases plus the default, all joining in one block.
+		void CFGGenerator::genSwitch(unsigned depth) {
+			unsigned arms = shape_.switchFanout + 1;
+			Value* selector = B_.CreateAnd(pickVariable(), B_.getInt32(2 * shape_.switchFanout - 1));
+			std::vector<BasicBlock*> entries;
+			for (unsigned a = 0; a < arms; ++a) {
+				entries.push_back(newBlock(a == 0 ? "default" : "case"));
+			}
+			BasicBlock* join = newBlock("join");
+			SwitchInst* sw = B_.CreateSwitch(selector, entries[0], shape_.switchFanout);
+			for (unsigned a = 1; a < arms; ++a) {
+				sw->addCase(B_.getInt32(a - 1), entries[a]);
+			}
+
+			Variables dominating = vars_;
+			std::vector<std::pair<BasicBlock*, Variables>> incoming;
+			for (BasicBlock* entry : entries) {
+				vars_ = dominating;
+				B_.SetInsertPoint(entry);
+				emitExpressions();
+				if (chance(0.25)) {
+					genSequence(depth + 1, 1);
+				}
+				B_.CreateBr(join);
+				incoming.push_back({B_.GetInsertBlock(), vars_});
+			}
+			B_.SetInsertPoint(join);
+			joinVariables(join, incoming, dominating);
+			emitExpressions();
+		}
+
+		// pre -> a | b, a <-> b, a | b -> exit: a cycle with two entries, so no block dominates the other.
+		void CFGGenerator::genIrreducible() {
+			irreducibleLeft_--;
+			BasicBlock* pre = B_.GetInsertBlock();
+			BasicBlock* a = newBlock("irr.a");
+			BasicBlock* b = newBlock("irr.b");
+			BasicBlock* exit = newBlock("irr.exit");
+			B_.CreateCondBr(emitCondition(), a, b);
+
+			Variables dominating = vars_;
+			std::vector<PHINode*> phisA(vars_.size(), nullptr), phisB(vars_.size(), nullptr);
+			auto enter = [&](BasicBlock* block, std::vector<PHINode*>& phis) {
+				vars_ = dominating;
+				B_.SetInsertPoint(block);
+				for (unsigned i = 0; i < vars_.size(); ++i) {
+					if (chance(shape_.phiDensity)) {
+						phis[i] = B_.CreatePHI(B_.getInt32Ty(), 2);
+						phis[i]->addIncoming(dominating[i], pre);
+						vars_[i] = phis[i];
+					}
+				}
+				emitExpressions();
+			};
+			// Add the values at the end of the other block of the cycle to the PHIs of a block.
+			auto close = [&](std::vector<PHINode*>& phis, BasicBlock* from, const Variables& values) {
+				for (unsigned i = 0; i < phis.size(); ++i) {
+					if (phis[i]) {
+						phis[i]->addIncoming(values[i], from);
+					}
+				}
+			};
+
+			enter(a, phisA);
+			B_.CreateCondBr(emitCondition(), b, exit);
+			Variables atA = vars_;
+			enter(b, phisB);
+			B_.CreateCondBr(emitCondition(), a, exit);
+			Variables atB = vars_;
+			close(phisA, b, atB);
+			close(phisB, a, atA);
+
+			B_.SetInsertPoint(exit);
+			std::pair<BasicBlock*, Variables> incoming[] = {{a, atA}, {b, atB}};
+			joinVariables(exit, incoming, dominating);
+			emitExpressions();
+		}
+
+		void CFGGenerator::joinVariables(BasicBlock* join, ArrayRef<std::pair<BasicBlock*, Variables>> incoming,
+			const Variables& dominating) {
+			IRBuilder<>::InsertPointGuard guard(B_);
+			B_.SetInsertPoint(join, join->begin());
+			for (unsigned i = 0; i < vars_.size(); ++i) {
+				Value* first = incoming[0].second[i];
+				bool same = std::all_of(incoming.begin(), incoming.end(),
+					[&](const std::pair<BasicBlock*, Variables>& in) { return in.second[i] == first; });
+				if (same) {
+					vars_[i] = first;
+				} else if (chance(shape_.phiDensity)) {
+					PHINode* phi = B_.CreatePHI(B_.getInt32Ty(), incoming.size());
+					for (auto& [block, values] : incoming) {
+						phi->addIncoming(values[i], block);
+					}
+					vars_[i] = phi;
+				} else {
+					vars_[i] = dominating[i];
+				}
+			}
+		}
+
+		Function* CFGGenerator::run() {
+			for (Argument& arg : F_->args()) {
+				vars_.push_back(&arg);
+			}
+			bound_ = vars_.back();
+			vars_.pop_back();
+			B_.SetInsertPoint(newBlock("entry"));
+			emitExpressions();
+			genSequence(0, 0);
+			B_.CreateRet(vars_[0]);
+			if (verifyFunction(*F_, &errs())) {
+				report_fatal_error("generated function is broken");
+			}
+			return F_;
+		}
+	}
+
+	Function* generateFunction(Module& M, const CFGShape& shape, StringRef name) {
+		return CFGGenerator(M, shape, name).run();
+	}
+}
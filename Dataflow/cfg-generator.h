@@ -0,0 +1,37 @@
+// 15-745 Assignment 2: cfg-generator.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __CFG_GENERATOR_H__
+#define __CFG_GENERATOR_H__
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+
+namespace llvm {
+	// Shape of a synthetic function built by generateFunction(). All values are i32 variables threaded through
+	// the CFG in SSA form; the same seed always yields the same function.
+	struct CFGShape {
+		// Number of basic blocks to create (a few more may be needed to close the last region).
+		unsigned blocks = 64;
+		// Maximum loop nesting depth. 0 creates no loops.
+		unsigned loopDepth = 2;
+		// Number of irreducible regions: two-block cycles entered through both blocks.
+		unsigned irreducible = 0;
+		// Number of cases of each switch. 0 creates no switches.
+		unsigned switchFanout = 0;
+		// Binary operators emitted per block.
+		unsigned expressions = 4;
+		// Number of variables, which are also the arguments of the function.
+		unsigned variables = 8;
+		// Probability that a variable redefined in a region gets a PHI where the region's paths join.
+		double phiDensity = 0.5;
+		unsigned seed = 1;
+	};
+
+	// Append a function named name with the given shape to M. The function is verified before returning.
+	Function* generateFunction(Module& M, const CFGShape& shape, StringRef name = "bench");
+}
+
+#endif
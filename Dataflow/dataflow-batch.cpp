@@ -0,0 +1,274 @@
+// 15-745 Assignment 2: dataflow-batch.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+// Batch driver: runs liveness and/or available expressions on many bitcode files without opt. The files
+// go through three overlapping stages connected by bounded queues:
+//   load:    one thread memory-maps each file and reads its module lazily, which only parses the
+//            globals and the function prototypes, in its own LLVMContext;
+//   analyze: -dataflow-threads workers each take a whole module, materialize the body of each selected
+//            function right before analyzing it and write the results into a buffer of the file;
+//   emit:    the main thread writes the buffers to -o in command line order.
+// A module is only used by one thread at a time, so the modules need no locking.
+//   ./dataflow-batch -analysis=liveness -dataflow-output=jsonl -o results.jsonl build/*.bc
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "available-support.h"
+#include "liveness-support.h"
+#include "parallel-driver.h"
+
+using namespace llvm;
+
+static cl::list<std::string> Inputs(cl::Positional, cl::desc("<input bitcode files>"), cl::OneOrMore);
+static cl::opt<std::string> Analysis("analysis", cl::desc("liveness, available or both"), cl::init("both"));
+static cl::opt<std::string> Output("o", cl::desc("Write the results to this file"), cl::init("-"));
+static cl::list<std::string> Functions("functions", cl::CommaSeparated,
+	cl::desc("Only materialize and analyze these functions (default: all)"));
+static cl::opt<unsigned> QueueDepth("queue-depth",
+	cl::desc("Modules waiting between two stages, per analysis worker"), cl::init(2));
+static cl::opt<bool> Summary("summary", cl::desc("Print file, function and stage time totals to stderr"));
+
+namespace {
+	// One input file on its way through the stages.
+	struct BatchJob {
+		unsigned index;
+		std::string path;
+		// Destroyed after the module, which lives in it.
+		std::unique_ptr<LLVMContext> context;
+		std::unique_ptr<Module> module;
+		std::string error;
+		std::string output;
+		unsigned functions = 0;
+		unsigned materialized = 0;
+	};
+
+	// Queue between two stages. push() blocks while the queue holds capacity items, so a fast stage
+	// cannot run arbitrarily far ahead of a slow one. pop() blocks until an item arrives and returns
+	// null once the queue is closed and empty.
+	template <class T>
+	class StageQueue {
+		public:
+			explicit StageQueue(size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {}
+
+			void push(std::unique_ptr<T> item) {
+				std::unique_lock<std::mutex> guard(lock_);
+				notFull_.wait(guard, [&] { return items_.size() < capacity_; });
+				items_.push_back(std::move(item));
+				notEmpty_.notify_one();
+			}
+
+			std::unique_ptr<T> pop() {
+				std::unique_lock<std::mutex> guard(lock_);
+				notEmpty_.wait(guard, [&] { return !items_.empty() || closed_; });
+				if (items_.empty()) {
+					return nullptr;
+				}
+				std::unique_ptr<T> item = std::move(items_.front());
+				items_.pop_front();
+				notFull_.notify_one();
+				return item;
+			}
+
+			// No more pushes will follow.
+			void close() {
+				std::lock_guard<std::mutex> guard(lock_);
+				closed_ = true;
+				notEmpty_.notify_all();
+			}
+
+		private:
+			size_t capacity_;
+			std::mutex lock_;
+			std::condition_variable notEmpty_;
+			std::condition_variable notFull_;
+			std::deque<std::unique_ptr<T>> items_;
+			bool closed_ = false;
+	};
+
+	// Busy time of one stage, summed over its threads.
+	struct StageTime {
+		std::mutex lock;
+		double seconds = 0;
+
+		void add(std::chrono::steady_clock::time_point start) {
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::lock_guard<std::mutex> guard(lock);
+			seconds += elapsed;
+		}
+	};
+}
+
+// Memory-map the file of job and read its module. Bitcode is read lazily: function bodies stay
+// unparsed until they are materialized. Textual IR has no lazy form and is parsed whole.
+static void loadModule(BatchJob& job) {
+	ErrorOr<std::unique_ptr<MemoryBuffer>> buffer = MemoryBuffer::getFile(job.path, /*IsText=*/false,
+		/*RequiresNullTerminator=*/false);
+	if (!buffer) {
+		job.error = buffer.getError().message();
+		return;
+	}
+	job.context = std::make_unique<LLVMContext>();
+	MemoryBufferRef ref = (*buffer)->getMemBufferRef();
+	if (!isBitcode((const unsigned char*)ref.getBufferStart(), (const unsigned char*)ref.getBufferEnd())) {
+		SMDiagnostic diagnostic;
+		job.module = parseIR(ref, diagnostic, *job.context);
+		if (!job.module) {
+			job.error = (Twine(diagnostic.getLineNo()) + ":" + Twine(diagnostic.getColumnNo() + 1) + ": "
+				+ diagnostic.getMessage()).str();
+		}
+		return;
+	}
+	// The module takes the buffer and keeps it mapped until it is destroyed.
+	Expected<std::unique_ptr<Module>> module = getOwningLazyBitcodeModule(std::move(*buffer), *job.context);
+	if (!module) {
+		job.error = toString(module.takeError());
+		return;
+	}
+	job.module = std::move(*module);
+}
+
+// Materialize and analyze the selected functions of the module of job, in module order, into job.output.
+static void analyzeModule(BatchJob& job, const StringSet<>& selected) {
+	raw_string_ostream OS(job.output);
+	for (Function& F : *job.module) {
+		// Functions whose body is not read yet are not declarations.
+		if (F.isDeclaration()) {
+			continue;
+		}
+		if (!selected.empty() && !selected.count(F.getName())) {
+			continue;
+		}
+		if (F.isMaterializable()) {
+			if (Error error = F.materialize()) {
+				job.error = toString(std::move(error));
+				break;
+			}
+			++job.materialized;
+		}
+		++job.functions;
+		ResultEmitter emitter(OS, DataflowOutput);
+		if (Analysis == "liveness" || Analysis == "both") {
+			LivenessInfo(F).emit(emitter);
+		}
+		if (Analysis == "available" || Analysis == "both") {
+			AvailableExpressionsInfo(F).emit(emitter);
+		}
+	}
+	OS.flush();
+}
+
+int main(int argc, char** argv) {
+	cl::ParseCommandLineOptions(argc, argv, "Batch dataflow analysis of bitcode files\n");
+	if (Analysis != "liveness" && Analysis != "available" && Analysis != "both") {
+		errs() << "unknown -analysis=" << Analysis << "\n";
+		return 1;
+	}
+	std::error_code EC;
+	raw_fd_ostream OS(Output, EC, sys::fs::OF_Text);
+	if (EC) {
+		errs() << Output << ": " << EC.message() << "\n";
+		return 1;
+	}
+	StringSet<> selected;
+	for (const std::string& name : Functions) {
+		selected.insert(name);
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	unsigned numWorkers = std::min<size_t>(WorkStealingPool(DataflowThreads).numThreads(), Inputs.size());
+	StageQueue<BatchJob> loaded(QueueDepth * numWorkers);
+	StageQueue<BatchJob> analyzed(QueueDepth * numWorkers);
+	StageTime loadTime, analyzeTime, emitTime;
+
+	std::thread loader([&] {
+		for (unsigned i = 0; i < Inputs.size(); ++i) {
+			auto stageStart = std::chrono::steady_clock::now();
+			std::unique_ptr<BatchJob> job(new BatchJob());
+			job->index = i;
+			job->path = Inputs[i];
+			loadModule(*job);
+			loadTime.add(stageStart);
+			loaded.push(std::move(job));
+		}
+		loaded.close();
+	});
+	std::vector<std::thread> workers;
+	for (unsigned w = 0; w < numWorkers; ++w) {
+		workers.emplace_back([&] {
+			// Timers are not thread-safe; see PhaseTimerSuspension.
+			PhaseTimerSuspension noTimers;
+			while (std::unique_ptr<BatchJob> job = loaded.pop()) {
+				auto stageStart = std::chrono::steady_clock::now();
+				if (job->module) {
+					analyzeModule(*job, selected);
+				}
+				// Free the module here, not on the emitting thread.
+				job->module.reset();
+				job->context.reset();
+				analyzeTime.add(stageStart);
+				analyzed.push(std::move(job));
+			}
+		});
+	}
+	// The last worker to finish closes the output queue.
+	std::thread closer([&] {
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+		analyzed.close();
+	});
+
+	// Emit in command line order: hold back the files that finish before an earlier one.
+	std::map<unsigned, std::unique_ptr<BatchJob>> pending;
+	unsigned next = 0, numFunctions = 0, numMaterialized = 0, numErrors = 0;
+	while (std::unique_ptr<BatchJob> job = analyzed.pop()) {
+		pending[job->index] = std::move(job);
+		for (auto it = pending.find(next); it != pending.end(); it = pending.find(++next)) {
+			auto stageStart = std::chrono::steady_clock::now();
+			BatchJob& done = *it->second;
+			if (!done.error.empty()) {
+				errs() << done.path << ": " << done.error << "\n";
+				++numErrors;
+			}
+			OS << done.output;
+			numFunctions += done.functions;
+			numMaterialized += done.materialized;
+			pending.erase(it);
+			emitTime.add(stageStart);
+		}
+	}
+	loader.join();
+	closer.join();
+	OS.flush();
+
+	if (Summary) {
+		double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		errs() << Inputs.size() << " files (" << numErrors << " failed), " << numFunctions << " functions ("
+			<< numMaterialized << " materialized), " << numWorkers << " workers: load "
+			<< format("%.3f", loadTime.seconds) << " s, analyze " << format("%.3f", analyzeTime.seconds)
+			<< " s, emit " << format("%.3f", emitTime.seconds) << " s, wall " << format("%.3f", wall) << " s\n";
+	}
+	return numErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+// 15-745 Assignment 2: dataflow-bench.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+// Benchmark driver: generates one synthetic function (cfg-generator.h), runs liveness and/or available
+// expressions on it -reps times and appends one JSON record per analysis to -o. Run through `make bench`.
+// -analysis=fused-forward also checks the fused states against separate solves and fails if they differ.
+
+#include <algorithm>
+#include <chrono>
+#include <sys/resource.h>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "available-support.h"
+#include "cfg-generator.h"
+#include "liveness-support.h"
+
+using namespace llvm;
+
+static cl::opt<unsigned> Blocks("blocks", cl::desc("Number of basic blocks"), cl::init(64));
+static cl::opt<unsigned> LoopDepth("loop-depth", cl::desc("Maximum loop nesting depth"), cl::init(2));
+static cl::opt<unsigned> Irreducible("irreducible", cl::desc("Number of irreducible regions"), cl::init(0));
+static cl::opt<unsigned> SwitchFanout("switch-fanout", cl::desc("Cases per switch, 0 for no switches"), cl::init(0));
+static cl::opt<unsigned> Expressions("expressions", cl::desc("Binary operators per block"), cl::init(4));
+static cl::opt<unsigned> Variables("variables", cl::desc("Number of variables"), cl::init(8));
+static cl::opt<double> PhiDensity("phi-density", cl::desc("Probability of a PHI per variable and join"), cl::init(0.5));
+static cl::opt<unsigned> Seed("seed", cl::desc("Generator seed"), cl::init(1));
+static cl::opt<unsigned> Reps("reps", cl::desc("Solves per analysis; the fastest one is reported"), cl::init(3));
+static cl::opt<std::string> Analysis("analysis",
+	cl::desc("liveness, available, both, fused (both in one FusedDataflowDriver), or fused-forward "
+		"(available expressions and reaching definitions in one forward bundle)"), cl::init("both"));
+static cl::opt<std::string> Output("o", cl::desc("Append the JSON records to this file"), cl::init("-"));
+static cl::opt<std::string> EmitIR("emit-ir", cl::desc("Also write the generated module to this .ll file"));
+
+namespace {
+	// Reaching definitions over the instructions that define a value. A definition is killed by the other
+	// members of its PHI alias set, which define the same variable. Fused with available expressions by
+	// -analysis=fused-forward as a second forward gen/kill problem.
+	using ReachingDefinitions = DataflowAnalysis<Var, /** Forward = */ true>;
+
+	// The problems of -analysis=fused-forward, the universes they refer to and the driver solving them.
+	// The problems point into this object, so it is built in place and never moved.
+	struct ForwardProblems {
+		explicit ForwardProblems(Function& F);
+
+		// Solve both problems in the forward bundle of driver.
+		void solveFused(Function& F);
+		unsigned universe() const { return expressions.size() + definitions.size(); }
+
+		PhiAliasResolver aliases;
+		ExpressionCanonicalizer canonicalize;
+		DenseMap<Expression, int> expressions;
+		DenseMap<Value*, SmallVector<int, 4>> killIndex;
+		ReachingDefinitions::BitVectorOffsetMap definitions;
+		// Representative -> offsets of the definitions of its alias set.
+		DenseMap<Value*, SmallVector<int, 4>> aliasDefinitions;
+		ReachingDefinitions reaching;
+		FusedDataflowDriver driver;
+		FusedDataflowDriver::Handle availableHandle;
+		FusedDataflowDriver::Handle reachingHandle;
+	};
+
+	ForwardProblems::ForwardProblems(Function& F)
+		: aliases(F),
+		canonicalize(F, aliases),
+		expressions(createExpressionOffsets(F, canonicalize)),
+		killIndex(createKillIndex(expressions)),
+		definitions(ReachingDefinitions::createBitVectorOffsetMap(F, [](Instruction* inst)->std::vector<Var>{
+			if (inst->getType()->isVoidTy()) {
+				return {};
+			}
+			return {Var(inst)};
+		})),
+		reaching(unionMeet, [this](Instruction* inst, BitVector& gen, BitVector& kill) {
+			auto defined = definitions.find(Var(inst));
+			if (defined == definitions.end()) {
+				return;
+			}
+			for (int offset : aliasDefinitions.lookup(aliases.lookup(inst))) {
+				kill.set(offset);
+			}
+			gen.set(defined->second);
+		}, definitions.size(), false, false) {
+		for (auto& [var, offset] : definitions) {
+			aliasDefinitions[aliases.lookup(var.v)].push_back(offset);
+		}
+	}
+
+	void ForwardProblems::solveFused(Function& F) {
+		availableHandle = driver.addProblem(makeAvailableProblem(AvailablePolicy(canonicalize, expressions, killIndex)));
+		reachingHandle = driver.addProblem(reaching.toProblem("reaching-definitions"));
+		driver.solve(F);
+	}
+}
+
+// Solve the problems of -analysis=fused-forward fused and each on its own, and compare the states after
+// every instruction. Reports the first difference and returns false if there is one.
+static bool checkFusedForward(Function& F) {
+	ForwardProblems problems(F);
+	problems.solveFused(F);
+	AvailableExpressionsInfo available(F);
+	ReachingDefinitions::OffsetToElementMap definitions;
+	for (auto& [var, offset] : problems.definitions) {
+		definitions.insert({offset, var});
+	}
+	problems.reaching.setIterationStrategy(DataflowStrategy);
+	problems.reaching.setResultMode(DataflowResultMode, DataflowCheckpointInterval);
+	problems.reaching.setStateRepresentation(DataflowStates);
+	problems.reaching.solve(F, definitions);
+	for (BasicBlock& BB : F) {
+		for (Instruction& I : BB) {
+			const char* problem = nullptr;
+			if (problems.driver.stateAt(problems.availableHandle, &I) != available.getAvailableAfter(&I)) {
+				problem = "available expressions";
+			} else if (problems.driver.stateAt(problems.reachingHandle, &I) != problems.reaching.stateAt(&I)) {
+				problem = "reaching definitions";
+			}
+			if (problem) {
+				errs() << "fused-forward: " << problem << " after " << getShortValueName(&I) << " in block "
+					<< getShortValueName(&BB) << " differ from the separate solve\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// Peak resident set size of the process in kilobytes.
+static long peakRSSKb() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;
+}
+
+static const char* strategyName() {
+	switch (DataflowStrategy) {
+		case IterationStrategy::RoundRobin: return "round-robin";
+		case IterationStrategy::Worklist: return "worklist";
+		case IterationStrategy::WeakTopological: return "wto";
+	}
+	return "?";
+}
+
+static const char* statesName() {
+	switch (DataflowStates) {
+		case StateRepresentation::Dense: return "dense";
+		case StateRepresentation::Adaptive: return "adaptive";
+		case StateRepresentation::Interned: return "interned";
+	}
+	return "?";
+}
+
+// Solve reps times with solve, which returns the solver counters and the universe size, and write one
+// record. A state is one block visit or one materialized per-instruction state, so statesPerSec measures
+// the solver and the result materialization together.
+template <class Solve>
+static void run(StringRef name, Function& F, unsigned numInstructions, Solve solve, raw_ostream& OS) {
+	double bestMs = 0;
+	SolverStats stats;
+	unsigned universe = 0;
+	for (unsigned r = 0; r < std::max(1u, (unsigned)Reps); ++r) {
+		auto start = std::chrono::steady_clock::now();
+		std::pair<SolverStats, unsigned> result = solve(F);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		if (r == 0 || ms < bestMs) {
+			bestMs = ms;
+		}
+		stats = result.first;
+		universe = result.second;
+	}
+	double states = stats.blockVisits + (double)numInstructions;
+	OS << "{\"analysis\":\"" << name << "\""
+		<< ",\"blocks\":" << Blocks << ",\"loopDepth\":" << LoopDepth << ",\"irreducible\":" << Irreducible
+		<< ",\"switchFanout\":" << SwitchFanout << ",\"expressions\":" << Expressions
+		<< ",\"variables\":" << Variables << ",\"phiDensity\":" << format("%.2f", (double)PhiDensity)
+		<< ",\"seed\":" << Seed
+		<< ",\"strategy\":\"" << strategyName() << "\""
+		<< ",\"livenessEngine\":\"" << (DataflowLivenessEngine == LivenessEngine::Sparse ? "sparse" : "dense") << "\""
+		<< ",\"states\":\"" << statesName() << "\""
+		<< ",\"functionBlocks\":" << F.size() << ",\"instructions\":" << numInstructions
+		<< ",\"universe\":" << universe
+		<< ",\"wallMs\":" << format("%.3f", bestMs)
+		<< ",\"iterations\":" << stats.changedBoundaries << ",\"blockVisits\":" << stats.blockVisits
+		<< ",\"componentIterations\":" << stats.componentIterations
+		<< ",\"bytesAllocated\":" << (uint64_t)stats.bytesAllocated
+		<< ",\"stateRows\":" << stats.stateRows << ",\"uniqueStates\":" << stats.uniqueStates
+		<< ",\"peakRssKb\":" << peakRSSKb()
+		<< ",\"statesPerSec\":" << format("%.0f", bestMs > 0 ? states * 1000 / bestMs : 0.0) << "}\n";
+}
+
+int main(int argc, char** argv) {
+	cl::ParseCommandLineOptions(argc, argv, "Dataflow analysis benchmark on synthetic CFGs\n");
+	if (Analysis != "liveness" && Analysis != "available" && Analysis != "both" && Analysis != "fused" &&
+		Analysis != "fused-forward") {
+		errs() << "unknown -analysis=" << Analysis << "\n";
+		return 1;
+	}
+
+	LLVMContext context;
+	Module M("bench", context);
+	CFGShape shape;
+	shape.blocks = Blocks;
+	shape.loopDepth = LoopDepth;
+	shape.irreducible = Irreducible;
+	shape.switchFanout = SwitchFanout;
+	shape.expressions = Expressions;
+	shape.variables = Variables;
+	shape.phiDensity = PhiDensity;
+	shape.seed = Seed;
+	Function& F = *generateFunction(M, shape);
+	unsigned numInstructions = F.getInstructionCount();
+
+	std::error_code EC;
+	if (!EmitIR.empty()) {
+		raw_fd_ostream IR(EmitIR, EC, sys::fs::OF_Text);
+		if (EC) {
+			errs() << EmitIR << ": " << EC.message() << "\n";
+			return 1;
+		}
+		M.print(IR, nullptr);
+	}
+	raw_fd_ostream OS(Output, EC, sys::fs::OF_Append | sys::fs::OF_Text);
+	if (EC) {
+		errs() << Output << ": " << EC.message() << "\n";
+		return 1;
+	}
+
+	if (Analysis == "liveness" || Analysis == "both") {
+		run("liveness", F, numInstructions, [](Function& F) {
+			LivenessInfo info(F);
+			return std::make_pair(info.getStats(), info.getNumValues());
+		}, OS);
+	}
+	if (Analysis == "available" || Analysis == "both") {
+		run("available", F, numInstructions, [](Function& F) {
+			AvailableExpressionsInfo info(F);
+			return std::make_pair(info.getStats(), info.getNumExpressions());
+		}, OS);
+	}
+	if (Analysis == "fused") {
+		// One alias resolver for both problems; each direction is one bundle.
+		run("fused", F, numInstructions, [](Function& F) {
+			PhiAliasResolver aliases(F);
+			LivenessDataflow::BitVectorOffsetMap variables = createLivenessOffsets(F, aliases);
+			ExpressionCanonicalizer canonicalize(F, aliases);
+			DenseMap<Expression, int> expressions = createExpressionOffsets(F, canonicalize);
+			DenseMap<Value*, SmallVector<int, 4>> killIndex = createKillIndex(expressions);
+			FusedDataflowDriver driver;
+			driver.addProblem(makeLivenessProblem(LivenessPolicy(aliases, variables)));
+			driver.addProblem(makeAvailableProblem(AvailablePolicy(canonicalize, expressions, killIndex)));
+			driver.solve(F);
+			return std::make_pair(driver.getStats(), (unsigned)(variables.size() + expressions.size()));
+		}, OS);
+	}
+	if (Analysis == "fused-forward") {
+		// Both problems in the forward bundle: one traversal and one wide state for both.
+		run("fused-forward", F, numInstructions, [](Function& F) {
+			ForwardProblems problems(F);
+			problems.solveFused(F);
+			return std::make_pair(problems.driver.getStats(), problems.universe());
+		}, OS);
+		if (!checkFusedForward(F)) {
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,143 @@
+// 15-745 Assignment 2: dataflow-metrics.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <memory>
+#include <mutex>
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "dataflow-metrics.h"
+
+#define DEBUG_TYPE "dataflow"
+
+namespace llvm {
+	STATISTIC(NumSolves, "Number of dataflow solves");
+	STATISTIC(NumBlockVisits, "Number of block transfer function runs");
+	STATISTIC(NumChangedBoundaries, "Number of block visits that changed a boundary");
+	STATISTIC(NumComponentIterations, "Number of passes over weak topological order components");
+	STATISTIC(NumMeets, "Number of neighbour states met into block inputs");
+	STATISTIC(NumTransfers, "Number of transfer function evaluations");
+	STATISTIC(MaxUniverse, "Largest universe of a solve");
+	STATISTIC(NumStateBytes, "Bytes of state allocated by all solves");
+	STATISTIC(NumSparseStates, "Number of states stored as sparse chunks");
+	STATISTIC(NumComplementStates, "Number of states stored as complemented chunks");
+	STATISTIC(NumStateRows, "Number of rows of all state stores");
+	STATISTIC(NumUniqueStates, "Number of distinct states of interned state stores");
+
+	static cl::opt<bool> DataflowTimePhases(
+		"dataflow-time-phases",
+		cl::desc("Time alias resolution, offset map, solve and result emission of the dataflow passes"),
+		cl::init(false));
+
+	static cl::opt<std::string> DataflowMetrics(
+		"dataflow-metrics",
+		cl::desc("Append one JSON record of solver counters per analyzed function to this file ('-' for stderr)"),
+		cl::value_desc("file"));
+
+	static const char* const PhaseNames[NumDataflowPhases] = {
+		"alias resolution", "offset map", "solve", "result emission"
+	};
+	static const char* const PhaseKeys[NumDataflowPhases] = {
+		"aliasMs", "offsetMapMs", "solveMs", "emitMs"
+	};
+
+	static thread_local bool PhaseTimersSuspended = false;
+
+	// The "dataflow" TimerGroup, created on first use and printed when it is destroyed at exit.
+	static Timer* phaseTimer(DataflowPhase phase) {
+		if (!DataflowTimePhases || PhaseTimersSuspended) {
+			return nullptr;
+		}
+		static struct PhaseTimers {
+			TimerGroup group{"dataflow", "Dataflow analysis phases"};
+			Timer timers[NumDataflowPhases] = {
+				{"alias", PhaseNames[0], group},
+				{"offsets", PhaseNames[1], group},
+				{"solve", PhaseNames[2], group},
+				{"emit", PhaseNames[3], group},
+			};
+		} phaseTimers;
+		return &phaseTimers.timers[(unsigned)phase];
+	}
+
+	void recordSolverStatistics(const SolverStats& stats) {
+		NumSolves++;
+		NumBlockVisits += stats.blockVisits;
+		NumChangedBoundaries += stats.changedBoundaries;
+		NumComponentIterations += stats.componentIterations;
+		NumMeets += stats.meets;
+		NumTransfers += stats.transfers;
+		MaxUniverse.updateMax(stats.universe);
+		NumStateBytes += stats.bytesAllocated;
+		NumSparseStates += stats.sparseStates;
+		NumComplementStates += stats.complementStates;
+		NumStateRows += stats.stateRows;
+		NumUniqueStates += stats.uniqueStates;
+	}
+
+	PhaseRegion::PhaseRegion(DataflowPhase phase, PhaseTimes* times)
+		: region_(phaseTimer(phase)), times_(times), phase_(phase), start_(std::chrono::steady_clock::now()) {}
+
+	PhaseRegion::~PhaseRegion() {
+		if (times_) {
+			times_->seconds[(unsigned)phase_] +=
+				std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+		}
+	}
+
+	PhaseTimerSuspension::PhaseTimerSuspension() : previous_(PhaseTimersSuspended) {
+		PhaseTimersSuspended = true;
+	}
+
+	PhaseTimerSuspension::~PhaseTimerSuspension() {
+		PhaseTimersSuspended = previous_;
+	}
+
+	void emitFunctionMetrics(StringRef analysis, const Function& F, const SolverStats& stats,
+		const PhaseTimes& times) {
+		if (DataflowMetrics.empty()) {
+			return;
+		}
+		// Format the record first, so the lock only covers the write.
+		std::string record;
+		raw_string_ostream OS(record);
+		OS << "{\"analysis\":\"" << analysis << "\",\"function\":\"";
+		OS.write_escaped(F.getName());
+		OS << "\",\"blocks\":" << F.size() << ",\"instructions\":" << F.getInstructionCount()
+			<< ",\"universe\":" << stats.universe << ",\"meets\":" << stats.meets
+			<< ",\"transfers\":" << stats.transfers << ",\"blockVisits\":" << stats.blockVisits
+			<< ",\"changedBoundaries\":" << stats.changedBoundaries
+			<< ",\"components\":" << stats.components << ",\"componentIterations\":" << stats.componentIterations
+			<< ",\"bytesAllocated\":" << (uint64_t)stats.bytesAllocated
+			<< ",\"sparseStates\":" << stats.sparseStates << ",\"complementStates\":" << stats.complementStates
+			<< ",\"stateRows\":" << stats.stateRows << ",\"uniqueStates\":" << stats.uniqueStates;
+		for (unsigned p = 0; p < NumDataflowPhases; ++p) {
+			OS << ",\"" << PhaseKeys[p] << "\":" << format("%.3f", times.seconds[p] * 1000);
+		}
+		OS << "}\n";
+		OS.flush();
+
+		static std::mutex lock;
+		static std::unique_ptr<raw_fd_ostream> file;
+		std::lock_guard<std::mutex> guard(lock);
+		if (DataflowMetrics == "-") {
+			errs() << record;
+			return;
+		}
+		if (!file) {
+			std::error_code EC;
+			file = std::make_unique<raw_fd_ostream>(DataflowMetrics, EC, sys::fs::OF_Text);
+			if (EC) {
+				errs() << DataflowMetrics << ": " << EC.message() << "\n";
+				file.reset();
+				return;
+			}
+		}
+		*file << record;
+		file->flush();
+	}
+}
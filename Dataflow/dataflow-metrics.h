@@ -0,0 +1,93 @@
+// 15-745 Assignment 2: dataflow-metrics.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DATAFLOW_METRICS_H__
+#define __DATAFLOW_METRICS_H__
+
+#include <chrono>
+#include <cstddef>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Timer.h"
+
+namespace llvm {
+	// Solver counters of the last solve.
+	struct SolverStats {
+		// Number of times a block transfer function was run.
+		int blockVisits = 0;
+		// Number of block visits that changed the block boundary.
+		int changedBoundaries = 0;
+		// Weak topological order: number of loop components, and number of passes over component bodies.
+		int components = 0;
+		long componentIterations = 0;
+		// Number of neighbour states met into block inputs.
+		long meets = 0;
+		// Number of transfer function evaluations: per instruction, per gen/kill summary or per block.
+		long transfers = 0;
+		// Number of elements of the universe.
+		unsigned universe = 0;
+		// Bytes held by the state store.
+		size_t bytesAllocated = 0;
+		// Rows of the state store kept as sparse or complemented chunks (adaptive state representation).
+		unsigned sparseStates = 0;
+		unsigned complementStates = 0;
+		// Rows of the state store, and the distinct states they hold when the store interns its states
+		// (0 otherwise).
+		unsigned stateRows = 0;
+		unsigned uniqueStates = 0;
+	};
+
+	// Phases of one analysis run, timed into the "dataflow" TimerGroup with -dataflow-time-phases.
+	enum class DataflowPhase { AliasResolution, OffsetMap, Solve, ResultEmission };
+	constexpr unsigned NumDataflowPhases = 4;
+
+	// Wall time of the phases of one function, in seconds.
+	struct PhaseTimes {
+		double seconds[NumDataflowPhases] = {};
+	};
+
+	// Collect -stats counters from the counters of one solve.
+	void recordSolverStatistics(const SolverStats& stats);
+
+	// Times a phase for as long as it lives: into its Timer of the "dataflow" TimerGroup (with
+	// -dataflow-time-phases, outside of a PhaseTimerSuspension) and into times, if given.
+	class PhaseRegion {
+		public:
+			explicit PhaseRegion(DataflowPhase phase, PhaseTimes* times = nullptr);
+			~PhaseRegion();
+
+		private:
+			TimeRegion region_;
+			PhaseTimes* times_;
+			DataflowPhase phase_;
+			std::chrono::steady_clock::time_point start_;
+	};
+
+	// Run fn as phase and return its result.
+	template <class Fn>
+	auto timePhase(DataflowPhase phase, PhaseTimes& times, Fn&& fn) -> decltype(fn()) {
+		PhaseRegion region(phase, &times);
+		return fn();
+	}
+
+	// Timer and TimerGroup are not thread-safe. The parallel drivers suspend the phase timers on their
+	// worker threads, so phases run there only feed the per-function metrics.
+	class PhaseTimerSuspension {
+		public:
+			PhaseTimerSuspension();
+			~PhaseTimerSuspension();
+
+		private:
+			bool previous_;
+	};
+
+	// With -dataflow-metrics=<file>, append one JSON record with the counters and phase times of one
+	// analysis run on F. Safe to call from several threads.
+	void emitFunctionMetrics(StringRef analysis, const Function& F, const SolverStats& stats,
+		const PhaseTimes& times);
+}
+
+#endif
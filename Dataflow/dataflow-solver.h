@@ -0,0 +1,788 @@
+// 15-745 Assignment 2: dataflow-solver.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DATAFLOW_SOLVER_H__
+#define __DATAFLOW_SOLVER_H__
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+
+#include "bitset-kernels.h"
+#include "dataflow-metrics.h"
+#include "state-store.h"
+#include "weak-topological-order.h"
+
+namespace llvm {
+	// Order in which the solver visits basic blocks until the fixed point is reached.
+	enum class IterationStrategy {
+		// Re-run every reachable block on each pass until a whole pass changes nothing.
+		RoundRobin,
+		// Only re-run blocks whose neighbouring boundaries changed, in RPO priority order.
+		Worklist,
+		// Follow a weak topological order of the CFG (weak-topological-order.h) and stabilize every loop
+		// component, innermost first, before moving on. Blocks whose neighbouring boundaries did not change
+		// are skipped.
+		WeakTopological
+	};
+
+	// What the solver keeps of the per-instruction states.
+	enum class ResultMode {
+		// Store the state after every instruction.
+		Eager,
+		// Store block boundaries and optional checkpoints only; states are recomputed by stateAt().
+		Lazy
+	};
+
+	// Per-instruction states produced by a block transfer function: the state after each instruction.
+	using InstructionStateMap = DenseMap<Instruction*, BitVector>;
+
+	// How a solver policy describes its transfer function.
+	enum class TransferKind {
+		// void genKill(Instruction*, BitVector& gen, BitVector& kill) const, for state' = (state - kill) ∪ gen.
+		// Composed into one summary per block before solving (block summary mode).
+		GenKill,
+		// void transfer(BitVector& state, Instruction*) const, applied to each instruction in analysis order.
+		Instruction,
+		// BitVector transferBlock(BitVector state, BasicBlock*, InstructionStateMap&) const, which also
+		// records the per-instruction states itself.
+		Block,
+		// Chosen at run time by TransferKind dynamicTransferKind() const. The policy provides all three functions.
+		Dynamic
+	};
+
+	// Meet policies. topValue() is the identity of the meet, the initial value of every block boundary.
+	struct UnionMeetPolicy {
+		static constexpr bool topValue() { return false; }
+		static void meet(BitVector& state, ArrayRef<StateRef> inputs) {
+			meetUnion(state, inputs);
+		}
+	};
+
+	struct IntersectionMeetPolicy {
+		static constexpr bool topValue() { return true; }
+		static void meet(BitVector& state, ArrayRef<StateRef> inputs) {
+			meetIntersection(state, inputs);
+		}
+	};
+
+	// Whether Policy provides boundaryState().
+	template <class Policy, class = void>
+	struct HasBoundaryState : std::false_type {};
+	template <class Policy>
+	struct HasBoundaryState<Policy, decltype(std::declval<const Policy&>().boundaryState(std::declval<BitVector&>()))>
+		: std::true_type {};
+
+	// Iterative bitvector dataflow solver with the analysis given at compile time by Policy, so the meet and
+	// the transfer functions are inlined into the block loop. A policy provides:
+	//   static constexpr bool forward;                  direction of the analysis
+	//   static constexpr TransferKind transferKind;     which transfer function below it implements
+	//   bool topValue() const;                          initial value of every block boundary (meet identity)
+	//   bool boundaryValue() const;                     input of the entry (forward) or exit (backward) blocks
+	//   void meet(BitVector& state, ArrayRef<StateRef> inputs) const;
+	//                                                   state = state meet inputs[0] meet ... meet inputs[n - 1]
+	//   the transfer function(s) named by transferKind.
+	// A policy whose boundary input is not the same for every element can also provide
+	//   void boundaryState(BitVector& state) const;     set state (already sized) to the boundary input
+	// which is used instead of boundaryValue().
+	// topValue(), boundaryValue() and meet() usually come from UnionMeetPolicy / IntersectionMeetPolicy and
+	// a static constexpr boundaryValue(). DataflowAnalysis wraps std::function callbacks in a Dynamic policy.
+	template <class Policy>
+	class DataflowSolver {
+		public:
+			static constexpr bool Forward = Policy::forward;
+			using Word = StateStore::Word;
+
+			DataflowSolver(Policy policy, int numElements)
+				: policy_(std::move(policy)), bitVectorSize_(numElements) {}
+
+			Policy& getPolicy() { return policy_; }
+			const Policy& getPolicy() const { return policy_; }
+			int numElements() const { return bitVectorSize_; }
+
+			// Choose how solve() iterates to the fixed point. Defaults to IterationStrategy::Worklist.
+			void setIterationStrategy(IterationStrategy strategy) {
+				strategy_ = strategy;
+			}
+
+			// Choose whether solve() stores the state after every instruction (ResultMode::Eager) or only
+			// block boundaries plus a checkpoint every checkpointInterval instructions (ResultMode::Lazy).
+			// In both modes stateAt() rematerializes a state on demand.
+			// Lazy results need a per-instruction transfer or gen/kill function.
+			void setResultMode(ResultMode mode, unsigned checkpointInterval = 0) {
+				assert((mode == ResultMode::Eager || transferKind() != TransferKind::Block) &&
+					"lazy results need a per-instruction transfer function");
+				resultMode_ = mode;
+				checkpointInterval_ = checkpointInterval;
+			}
+
+			ResultMode getResultMode() const {
+				return resultMode_;
+			}
+
+			// Choose how the state store of the next solve keeps its rows. Defaults to
+			// StateRepresentation::Dense; StateRepresentation::Adaptive stores each state as sparse,
+			// complemented or dense words by density. The results are the same either way.
+			void setStateRepresentation(StateRepresentation representation) {
+				representation_ = representation;
+			}
+
+			StateRepresentation getStateRepresentation() const {
+				return representation_;
+			}
+
+			// Transfer function kind of the policy.
+			TransferKind transferKind() const {
+				if constexpr (Policy::transferKind == TransferKind::Dynamic) {
+					return policy_.dynamicTransferKind();
+				} else {
+					return Policy::transferKind;
+				}
+			}
+
+			// State after processing I, read from its row in the state store or recomputed from the nearest
+			// checkpoint or from the input state of I's block. Returns None if I was not reached by the last
+			// solve, or for block transfer policies, whose per-instruction states only lookupState() returns.
+			Optional<BitVector> stateAt(Instruction* I) const {
+				int block = states_.blockIndex(I->getParent());
+				if (block < 0 || transferKind() == TransferKind::Block) {
+					return None;
+				}
+				// Collect instructions back to the nearest stored state, in reverse analysis order.
+				SmallVector<Instruction*, 16> pending;
+				BitVector state;
+				for (Instruction* cur = I;;) {
+					int inst = states_.instructionIndex(cur);
+					if (inst >= 0) {
+						states_.load(states_.instructionRow(inst), state);
+						break;
+					}
+					pending.push_back(cur);
+					cur = Forward ? cur->getPrevNode() : cur->getNextNode();
+					if (!cur) {
+						states_.load(states_.inputRow(block), state);
+						break;
+					}
+				}
+				BitVector gen(bitVectorSize_), kill(bitVectorSize_);
+				for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+					applyInstruction(state, *it, gen, kill);
+				}
+				return state;
+			}
+
+			// Per-instruction state after the last solve, whatever the result mode and transfer function kind.
+			// Returns None for instructions the analysis did not reach.
+			Optional<BitVector> lookupState(Instruction* I) const {
+				if (transferKind() == TransferKind::Block) {
+					auto it = blockTransferResults_.find(I);
+					if (it == blockTransferResults_.end()) {
+						return None;
+					}
+					return it->second;
+				}
+				return stateAt(I);
+			}
+
+			// Block boundaries, block inputs and stored per-instruction states of the last solve.
+			const StateStore& getStates() const {
+				return states_;
+			}
+
+			// Per-instruction states recorded by a block transfer policy during the last solve.
+			InstructionStateMap takeBlockTransferResults() {
+				return std::move(blockTransferResults_);
+			}
+
+			// Free the state store and all other per-function state of the last solve.
+			void releaseStates() {
+				states_.release();
+				blockTransferResults_.clear();
+				blockSummaries_.clear();
+				neighbourBegin_.clear();
+				neighbours_.clear();
+				dependentBegin_.clear();
+				dependents_.clear();
+				solved_ = false;
+			}
+
+			// Counters collected by the last solve.
+			const SolverStats& getStats() const {
+				return stats_;
+			}
+
+			// Perform forward/backward dataflow analysis on the given function. States are kept in the
+			// solver's StateStore and queried with stateAt() / lookupState() / getStates().
+			// solve() only touches this object and reads the IR, so different solvers can solve different
+			// functions concurrently.
+			const StateStore& solve(Function& func) {
+				releaseStates();
+				stats_ = SolverStats();
+				allocateStates(func);
+				// Maintain per-basic-block boundary sets internally:
+				// Forward: OUT[BB]; Backward: IN[BB]
+				for (unsigned b = 0; b < states_.numBlocks(); ++b) {
+					states_.fill(states_.boundaryRow(b), policy_.topValue());
+				}
+				blockSummaries_.assign(states_.numBlocks(), BlockSummary());
+				if (strategy_ == IterationStrategy::RoundRobin) {
+					solveRoundRobin();
+				} else if (strategy_ == IterationStrategy::WeakTopological) {
+					solveWeakTopological();
+				} else {
+					std::vector<unsigned> all(states_.numBlocks());
+					for (unsigned b = 0; b < all.size(); ++b) {
+						all[b] = b;
+					}
+					solveWorklist(all);
+				}
+				materializeResults(std::vector<bool>(states_.numBlocks(), true), StateStore());
+				solved_ = true;
+				finishStats();
+				return states_;
+			}
+
+			// Re-converge after local edits of func, starting from the boundaries of the last solve() or update().
+			// invalidated holds the blocks whose instructions were edited and every inserted block. Blocks whose
+			// predecessors or successors changed are detected and invalidated automatically; removed blocks are
+			// simply dropped. Only the values that may depend on an invalidated block are reset to topValue()
+			// and recomputed, so the result is the same as a fresh solve(). For gen/kill policies this is
+			// narrowed to the elements whose block gen/kill sets changed, and stops at blocks that gen or kill
+			// them, so a local edit usually revisits a handful of blocks.
+			// numElements grows the universe in place when the edit introduced new elements. The policy must
+			// keep the offsets of the existing elements; the new elements are solved over the whole function.
+			// update() always iterates with the worklist.
+			const StateStore& update(Function& func, ArrayRef<BasicBlock*> invalidated, int numElements = -1) {
+				assert(solved_ && "update() needs a previous solve()");
+				int oldSize = bitVectorSize_;
+				if (numElements >= 0) {
+					assert(numElements >= oldSize && "the universe can only grow");
+					bitVectorSize_ = numElements;
+				}
+				bool grown = bitVectorSize_ != oldSize;
+				StateStore old = std::move(states_);
+				std::vector<unsigned> oldNeighbourBegin = std::move(neighbourBegin_);
+				std::vector<int> oldNeighbours = std::move(neighbours_);
+				std::vector<BlockSummary> oldSummaries = std::move(blockSummaries_);
+				neighbours_.clear();
+				dependents_.clear();
+				stats_ = SolverStats();
+				allocateStates(func);
+
+				unsigned numBlocks = states_.numBlocks();
+				bool genKill = transferKind() == TransferKind::GenKill;
+				DenseSet<BasicBlock*> edited(invalidated.begin(), invalidated.end());
+				std::vector<int> oldIndex(numBlocks);
+				// changed[b]: the transfer function or the neighbours of block b may have changed.
+				std::vector<bool> changed(numBlocks);
+				blockSummaries_.assign(numBlocks, BlockSummary());
+				BitVector state;
+				for (unsigned b = 0; b < numBlocks; ++b) {
+					BasicBlock* BB = states_.blocks()[b];
+					int o = oldIndex[b] = old.blockIndex(BB);
+					changed[b] = o < 0 || edited.count(BB) ||
+						!sameNeighbours(b, old, o, oldNeighbourBegin, oldNeighbours);
+					if (o < 0) {
+						states_.fill(states_.boundaryRow(b), policy_.topValue());
+						continue;
+					}
+					// Keep the converged boundary; new elements start at top.
+					old.load(old.boundaryRow(o), state);
+					state.resize(bitVectorSize_, policy_.topValue());
+					states_.store(states_.boundaryRow(b), state);
+					if (!grown && !edited.count(BB) && (unsigned)o < oldSummaries.size()) {
+						blockSummaries_[b] = std::move(oldSummaries[o]);
+					}
+				}
+
+				// mask[b]: elements whose value at the boundary of b may change. Seeded from the changed blocks
+				// (and the new elements everywhere), then pushed to the dependents. A gen/kill block whose
+				// summary gens or kills an element fixes its value, so the element stops spreading there.
+				std::vector<BitVector> mask(numBlocks, BitVector(bitVectorSize_));
+				std::vector<unsigned> pending;
+				std::vector<bool> queued(numBlocks, false);
+				for (unsigned b = 0; b < numBlocks; ++b) {
+					int o = oldIndex[b];
+					if (!changed[b]) {
+						// Unchanged block: only affected through its neighbours.
+					} else if (!genKill || o < 0 || (unsigned)o >= oldSummaries.size() ||
+						(edited.count(states_.blocks()[b]) && !oldSummaries[o].computed)) {
+						mask[b].set();
+					} else {
+						// Gen/kill blocks are separable per element. An edit inside the block affects the
+						// elements whose gen or kill bit changed. A change of neighbours affects the elements
+						// whose input changed and that the block neither gens nor kills.
+						const BlockSummary& summary = ensureBlockSummary(b);
+						if (edited.count(states_.blocks()[b])) {
+							BlockSummary& before = oldSummaries[o];
+							before.gen.resize(bitVectorSize_);
+							before.kill.resize(bitVectorSize_);
+							before.gen ^= summary.gen;
+							before.kill ^= summary.kill;
+							mask[b] |= before.gen;
+							mask[b] |= before.kill;
+						}
+						if (!sameNeighbours(b, old, o, oldNeighbourBegin, oldNeighbours)) {
+							BitVector input;
+							old.load(old.inputRow(o), input);
+							input.resize(bitVectorSize_, policy_.topValue());
+							computeInput(b, state);
+							input ^= state;
+							bitkernels::andNot(input, summary.gen);
+							bitkernels::andNot(input, summary.kill);
+							mask[b] |= input;
+						}
+					}
+					if (grown) {
+						mask[b].set(oldSize, bitVectorSize_);
+					}
+					if (mask[b].any()) {
+						queued[b] = true;
+						pending.push_back(b);
+					}
+				}
+				BitVector passed;
+				while (!pending.empty()) {
+					unsigned b = pending.back();
+					pending.pop_back();
+					queued[b] = false;
+					for (unsigned i = dependentBegin_[b]; i < dependentBegin_[b + 1]; ++i) {
+						int d = dependents_[i];
+						if (d < 0) {
+							continue;
+						}
+						passed = mask[b];
+						if (genKill) {
+							const BlockSummary& summary = ensureBlockSummary(d);
+							bitkernels::andNot(passed, summary.gen);
+							bitkernels::andNot(passed, summary.kill);
+						}
+						passed.reset(mask[d]);
+						if (passed.any()) {
+							mask[d] |= passed;
+							if (!queued[d]) {
+								queued[d] = true;
+								pending.push_back(d);
+							}
+						}
+					}
+				}
+
+				// Reset the affected values to top and re-converge from the blocks holding them. Blocks next to a
+				// reset block, and the edited blocks, get their per-instruction states recomputed.
+				std::vector<unsigned> seeds;
+				std::vector<bool> rematerialize(changed);
+				for (unsigned b = 0; b < numBlocks; ++b) {
+					if (!mask[b].any()) {
+						continue;
+					}
+					states_.load(states_.boundaryRow(b), state);
+					if (policy_.topValue()) {
+						state |= mask[b];
+					} else {
+						state.reset(mask[b]);
+					}
+					states_.store(states_.boundaryRow(b), state);
+					seeds.push_back(b);
+					rematerialize[b] = true;
+					for (unsigned i = dependentBegin_[b]; i < dependentBegin_[b + 1]; ++i) {
+						if (dependents_[i] >= 0) {
+							rematerialize[dependents_[i]] = true;
+						}
+					}
+				}
+				solveWorklist(seeds);
+				materializeResults(rematerialize, old);
+				finishStats();
+				return states_;
+			}
+
+		private:
+			struct BlockSummary {
+				BitVector gen;
+				BitVector kill;
+				bool computed = false;
+			};
+
+			// Record the size of the states in the counters of this solve and add them to the -stats counters.
+			void finishStats() {
+				stats_.universe = bitVectorSize_;
+				stats_.bytesAllocated = states_.bytesAllocated();
+				stats_.sparseStates = states_.numRows(StateKind::Sparse);
+				stats_.complementStates = states_.numRows(StateKind::Complement);
+				stats_.stateRows = states_.numRows();
+				if (states_.representation() == StateRepresentation::Interned) {
+					stats_.uniqueStates = states_.numUniqueStates();
+				}
+				recordSolverStatistics(stats_);
+			}
+
+			// Whether the policy may use transfer function kind K, so code calling it must be compiled.
+			static constexpr bool mayUse(TransferKind kind) {
+				return Policy::transferKind == kind || Policy::transferKind == TransferKind::Dynamic;
+			}
+
+			// Number the reached blocks of func in solving priority order (RPO for forward analyses, postorder
+			// for backward), allocate their rows and build the neighbour lists.
+			void allocateStates(Function& func) {
+				std::vector<BasicBlock*> order(po_begin(&func), po_end(&func));
+				if constexpr (Forward) {
+					std::reverse(order.begin(), order.end());
+				}
+				bool perInstruction = transferKind() != TransferKind::Block;
+				bool eager = resultMode_ == ResultMode::Eager;
+				unsigned interval = checkpointInterval_;
+				states_.allocate(order, bitVectorSize_, Forward, [&](Instruction&, unsigned index) {
+					if (!perInstruction) return false;
+					return eager || (interval != 0 && index % interval == 0);
+				}, representation_);
+				buildNeighbourLists();
+				top_ = BitVector(bitVectorSize_, policy_.topValue());
+			}
+
+			// Whether block b reads from the same blocks as block o of the previous numbering.
+			bool sameNeighbours(unsigned b, const StateStore& old, int o,
+				const std::vector<unsigned>& oldBegin, const std::vector<int>& oldNeighbours) const {
+				if (o < 0 || neighbourBegin_[b + 1] - neighbourBegin_[b] != oldBegin[o + 1] - oldBegin[o]) {
+					return false;
+				}
+				for (unsigned i = neighbourBegin_[b], j = oldBegin[o]; i < neighbourBegin_[b + 1]; ++i, ++j) {
+					BasicBlock* now = neighbours_[i] >= 0 ? states_.blocks()[neighbours_[i]] : nullptr;
+					BasicBlock* before = oldNeighbours[j] >= 0 ? old.blocks()[oldNeighbours[j]] : nullptr;
+					if (now != before) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// For every numbered block, the blocks it reads from (forward: predecessors, backward: successors)
+			// and the blocks that read from it, both as dense indices. A neighbour unreachable from the entry
+			// has no state row and is recorded as -1; it always contributes topValue().
+			void buildNeighbourLists() {
+				neighbourBegin_.assign(1, 0);
+				dependentBegin_.assign(1, 0);
+				for (BasicBlock* BB : states_.blocks()) {
+					auto addAll = [&](auto range, std::vector<int>& list, std::vector<unsigned>& begin) {
+						for (BasicBlock* N : range) {
+							list.push_back(states_.blockIndex(N));
+						}
+						begin.push_back(list.size());
+					};
+					if constexpr (Forward) {
+						addAll(predecessors(BB), neighbours_, neighbourBegin_);
+						addAll(successors(BB), dependents_, dependentBegin_);
+					} else {
+						addAll(successors(BB), neighbours_, neighbourBegin_);
+						addAll(predecessors(BB), dependents_, dependentBegin_);
+					}
+				}
+			}
+
+			// Sweep over every block until a whole pass changes nothing.
+			// Forward analyses sweep in postorder, backward analyses in reverse postorder.
+			void solveRoundRobin() {
+				BitVector scratch;
+				bool changed;
+				do {
+					changed = false;
+					for (unsigned b = states_.numBlocks(); b-- > 0;) {
+						changed |= visitBlock(b, scratch);
+					}
+				} while (changed);
+			}
+
+			// Only revisit the successors (forward) or predecessors (backward) of a block whose boundary changed.
+			// Pending blocks are popped lowest index first. Blocks are numbered in RPO for forward analyses and
+			// in postorder for backward analyses, so a block is normally visited after the neighbours it reads from.
+			// The worklist starts with the blocks in seeds.
+			void solveWorklist(ArrayRef<unsigned> seeds) {
+				unsigned numBlocks = states_.numBlocks();
+				std::priority_queue<unsigned, std::vector<unsigned>, std::greater<unsigned>> worklist;
+				std::vector<bool> queued(numBlocks, false);
+				for (unsigned b : seeds) {
+					queued[b] = true;
+					worklist.push(b);
+				}
+				BitVector scratch;
+				while (!worklist.empty()) {
+					unsigned b = worklist.top();
+					worklist.pop();
+					queued[b] = false;
+					if (!visitBlock(b, scratch)) {
+						continue;
+					}
+					for (unsigned i = dependentBegin_[b]; i < dependentBegin_[b + 1]; ++i) {
+						int d = dependents_[i];
+						if (d >= 0 && !queued[d]) {
+							queued[d] = true;
+							worklist.push(d);
+						}
+					}
+				}
+			}
+
+			// Iterate in a weak topological order of the dependence graph (successors for forward analyses,
+			// predecessors for backward ones). The search starts from the entry block, or from the exit blocks
+			// of a backward analysis; blocks that cannot reach an exit are picked up afterwards.
+			void solveWeakTopological() {
+				unsigned numBlocks = states_.numBlocks();
+				std::vector<unsigned> roots;
+				for (unsigned b = 0; b < numBlocks; ++b) {
+					if (neighbourBegin_[b] == neighbourBegin_[b + 1]) {
+						roots.push_back(b);
+					}
+				}
+				WeakTopologicalOrder wto(dependentBegin_, dependents_, roots);
+				stats_.components = wto.numComponents();
+				std::vector<bool> dirty(numBlocks, true);
+				BitVector scratch;
+				solveElements(wto, 0, numBlocks, dirty, scratch);
+			}
+
+			// Visit the elements of wto.order() in [begin, end), stabilizing each component in turn.
+			void solveElements(const WeakTopologicalOrder& wto, unsigned begin, unsigned end,
+				std::vector<bool>& dirty, BitVector& scratch) {
+				for (unsigned pos = begin; pos < end;) {
+					unsigned componentEnd = wto.componentEnd(pos);
+					if (componentEnd == 0) {
+						visitIfDirty(wto.order()[pos++], dirty, scratch);
+						continue;
+					}
+					// Visit the head, then the body until the head's boundary no longer changes. Everything
+					// before the component is stable, so a stable head means a stable component.
+					unsigned head = wto.order()[pos];
+					visitIfDirty(head, dirty, scratch);
+					do {
+						stats_.componentIterations++;
+						solveElements(wto, pos + 1, componentEnd, dirty, scratch);
+					} while (visitIfDirty(head, dirty, scratch));
+					pos = componentEnd;
+				}
+			}
+
+			// Visit block b if a neighbour's boundary changed since its last visit. Returns true if b's
+			// boundary changed, and marks its dependents.
+			bool visitIfDirty(unsigned b, std::vector<bool>& dirty, BitVector& scratch) {
+				if (!dirty[b]) {
+					return false;
+				}
+				dirty[b] = false;
+				if (!visitBlock(b, scratch)) {
+					return false;
+				}
+				for (unsigned i = dependentBegin_[b]; i < dependentBegin_[b + 1]; ++i) {
+					if (dependents_[i] >= 0) {
+						dirty[dependents_[i]] = true;
+					}
+				}
+				return true;
+			}
+
+			// Gen/kill summary of block b, composed from the gen/kill sets of its instructions on first use, in
+			// the order the analysis visits them: KILL = KILL1 ∪ KILL2, GEN = (GEN1 - KILL2) ∪ GEN2.
+			const BlockSummary& ensureBlockSummary(unsigned b) {
+				BlockSummary& summary = blockSummaries_[b];
+				if constexpr (mayUse(TransferKind::GenKill)) {
+					if (summary.computed) {
+						return summary;
+					}
+					BitVector gen(bitVectorSize_), kill(bitVectorSize_);
+					summary.gen = BitVector(bitVectorSize_, false);
+					summary.kill = BitVector(bitVectorSize_, false);
+					forEachInstruction(states_.blocks()[b], [&](Instruction& I) {
+						gen.reset();
+						kill.reset();
+						policy_.genKill(&I, gen, kill);
+						stats_.transfers++;
+						bitkernels::orInto(summary.kill, kill);
+						bitkernels::transfer(summary.gen, kill, gen);
+					});
+					summary.computed = true;
+				}
+				return summary;
+			}
+
+			// Per-instruction transfer of the instruction-level and block summary modes.
+			// Not counted in the solver stats, so stateAt() can stay const.
+			void applyInstruction(BitVector& state, Instruction* I, BitVector& gen, BitVector& kill) const {
+				if constexpr (mayUse(TransferKind::GenKill)) {
+					if (transferKind() == TransferKind::GenKill) {
+						gen.reset();
+						kill.reset();
+						policy_.genKill(I, gen, kill);
+						bitkernels::transfer(state, kill, gen);
+						return;
+					}
+				}
+				if constexpr (mayUse(TransferKind::Instruction)) {
+					policy_.transfer(state, I);
+				}
+			}
+
+			// After convergence, store the input state of every block for stateAt() and replay the
+			// per-instruction states once into the instruction rows: every instruction in eager mode, every
+			// checkpointInterval_-th one in lazy mode. Block transfer policies have filled
+			// blockTransferResults_ themselves while solving.
+			// Only blocks with rematerialize[b] set are recomputed; the rows of the other blocks are copied
+			// from old, the store of the previous solve.
+			void materializeResults(const std::vector<bool>& rematerialize, const StateStore& old) {
+				bool perInstruction = transferKind() != TransferKind::Block;
+				BitVector state, gen(bitVectorSize_), kill(bitVectorSize_);
+				for (unsigned b = 0; b < states_.numBlocks(); ++b) {
+					BasicBlock* BB = states_.blocks()[b];
+					if (!rematerialize[b] && copyBlockRows(b, old)) {
+						continue;
+					}
+					computeInput(b, state);
+					states_.store(states_.inputRow(b), state);
+					if (!perInstruction) {
+						continue;
+					}
+					forEachInstruction(BB, [&](Instruction& I) {
+						applyInstruction(state, &I, gen, kill);
+						stats_.transfers++;
+						int inst = states_.instructionIndex(&I);
+						if (inst >= 0) {
+							states_.store(states_.instructionRow(inst), state);
+						}
+					});
+				}
+			}
+
+			// Copy the input and instruction rows of block b from old. Returns false if old lacks one of them.
+			bool copyBlockRows(unsigned b, const StateStore& old) {
+				BasicBlock* BB = states_.blocks()[b];
+				int o = old.blockIndex(BB);
+				if (o < 0 || old.numElements() != states_.numElements()) {
+					return false;
+				}
+				for (Instruction& I : *BB) {
+					int inst = states_.instructionIndex(&I);
+					if (inst >= 0 && old.instructionIndex(&I) < 0) {
+						return false;
+					}
+				}
+				states_.copyRow(states_.inputRow(b), old, old.inputRow(o));
+				for (Instruction& I : *BB) {
+					int inst = states_.instructionIndex(&I);
+					if (inst >= 0) {
+						states_.copyRow(states_.instructionRow(inst), old, old.instructionRow(old.instructionIndex(&I)));
+					}
+				}
+				return true;
+			}
+
+			// Visit the instructions of BB in analysis order.
+			template <class Callback>
+			static void forEachInstruction(BasicBlock* BB, Callback&& callback) {
+				if constexpr (Forward) {
+					for (Instruction &I : *BB) callback(I);
+				} else {
+					for (auto it = BB->rbegin(); it != BB->rend(); ++it) callback(*it);
+				}
+			}
+
+			// Meet the boundaries of block b's neighbours into the state its transfer function starts from.
+			void computeInput(unsigned b, BitVector& state) {
+				unsigned begin = neighbourBegin_[b], end = neighbourBegin_[b + 1];
+				if (begin == end) {
+					// entry block (forward) or exit block (backward) init
+					if constexpr (HasBoundaryState<Policy>::value) {
+						state.resize(bitVectorSize_);
+						policy_.boundaryState(state);
+					} else {
+						state = BitVector(bitVectorSize_, policy_.boundaryValue());
+					}
+					return;
+				}
+				// Initialize to TOP: TOP meet X = X
+				state = top_;
+				SmallVector<StateRef, 4> inputs;
+				for (unsigned i = begin; i < end; ++i) {
+					int n = neighbours_[i];
+					inputs.push_back(n >= 0 ? states_.boundaryState(n) : StateRef(bitkernels::words(top_), bitVectorSize_));
+				}
+				policy_.meet(state, inputs);
+				stats_.meets += inputs.size();
+			}
+
+			// Run the block transfer function on the meet of block b's neighbours and store the new boundary.
+			// Returns true if the boundary changed.
+			bool visitBlock(unsigned b, BitVector& state) {
+				computeInput(b, state);
+				BasicBlock* BB = states_.blocks()[b];
+				TransferKind kind = transferKind();
+				if (kind == TransferKind::GenKill) {
+					// Block summary mode: one fused transfer per visit.
+					const BlockSummary& summary = ensureBlockSummary(b);
+					bitkernels::transfer(state, summary.kill, summary.gen);
+					stats_.transfers++;
+				} else if (kind == TransferKind::Instruction) {
+					// Walk instructions and apply transfer per instruction. Per-instruction states
+					// are only materialized after convergence.
+					if constexpr (mayUse(TransferKind::Instruction)) {
+						forEachInstruction(BB, [&](Instruction& I) {
+							policy_.transfer(state, &I);
+							stats_.transfers++;
+						});
+					}
+				} else {
+					if constexpr (mayUse(TransferKind::Block)) {
+						state = policy_.transferBlock(std::move(state), BB, blockTransferResults_);
+						stats_.transfers++;
+					}
+				}
+				stats_.blockVisits++;
+
+				if (states_.storeIfChanged(states_.boundaryRow(b), state)) {
+					stats_.changedBoundaries++;
+					return true;
+				}
+				return false;
+			}
+
+			Policy policy_;
+			int bitVectorSize_;
+			bool solved_ = false;
+			IterationStrategy strategy_ = IterationStrategy::Worklist;
+			SolverStats stats_;
+			ResultMode resultMode_ = ResultMode::Eager;
+			unsigned checkpointInterval_ = 0;
+			StateRepresentation representation_ = StateRepresentation::Dense;
+
+			// Per-function state of the last solve. All states live in states_; the rest is solver bookkeeping.
+			StateStore states_;
+			InstructionStateMap blockTransferResults_;
+			// Gen/kill summaries, kept after solving so update() can tell which elements an edit touched.
+			std::vector<BlockSummary> blockSummaries_;
+			// neighbours_[neighbourBegin_[b] .. neighbourBegin_[b + 1]) are the blocks b reads from,
+			// dependents_[dependentBegin_[b] .. dependentBegin_[b + 1]) the blocks that read from b.
+			std::vector<unsigned> neighbourBegin_;
+			std::vector<int> neighbours_;
+			std::vector<unsigned> dependentBegin_;
+			std::vector<int> dependents_;
+			// topValue(), the state of neighbours without a row.
+			BitVector top_;
+	};
+}
+
+#endif
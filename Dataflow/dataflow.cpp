@@ -2,28 +2,80 @@
 // Group: Haojia Sun (haojias), Yikang Cai (dcai)
 ////////////////////////////////////////////////////////////////////////////////
 
+#include "llvm/Support/Format.h"
+
 #include "dataflow.h"
 
 namespace llvm {
+	cl::opt<IterationStrategy> DataflowStrategy(
+		"dataflow-strategy",
+		cl::desc("Iteration strategy of the dataflow solver"),
+		cl::init(IterationStrategy::Worklist),
+		cl::values(
+			clEnumValN(IterationStrategy::Worklist, "worklist",
+				"Only revisit blocks whose inputs changed (default)"),
+			clEnumValN(IterationStrategy::RoundRobin, "round-robin",
+				"Sweep over all blocks until nothing changes"),
+			clEnumValN(IterationStrategy::WeakTopological, "wto",
+				"Stabilize loops innermost first along a weak topological order")));
+
+	cl::opt<ResultMode> DataflowResultMode(
+		"dataflow-results",
+		cl::desc("How the dataflow solver keeps per-instruction states"),
+		cl::init(ResultMode::Eager),
+		cl::values(
+			clEnumValN(ResultMode::Eager, "eager",
+				"Store the state after every instruction (default)"),
+			clEnumValN(ResultMode::Lazy, "lazy",
+				"Store block boundaries only and recompute states on query")));
+
+	cl::opt<unsigned> DataflowCheckpointInterval(
+		"dataflow-checkpoint-interval",
+		cl::desc("In lazy result mode, also store the state after every N-th instruction of a block"),
+		cl::init(0));
+
+	cl::opt<StateRepresentation> DataflowStates(
+		"dataflow-states",
+		cl::desc("How the dataflow solver stores its states"),
+		cl::init(StateRepresentation::Dense),
+		cl::values(
+			clEnumValN(StateRepresentation::Dense, "dense",
+				"One dense bitvector row per state (default)"),
+			clEnumValN(StateRepresentation::Adaptive, "adaptive",
+				"Sparse, complemented or dense rows chosen by density"),
+			clEnumValN(StateRepresentation::Interned, "interned",
+				"Rows refer to a hash-consed pool of distinct states")));
+
 	// Difference operator for BitVector
 	BitVector operator-(const BitVector& a, const BitVector& b) {
 		BitVector result = a;
-		for (int i = 0; i < b.size(); ++i) {
-			if (b.test(i)) {
-				result.reset(i);
-			}
-		}
+		bitkernels::andNot(result, b);
 		return result;
 	}
 
 	// Union operator for BitVector
 	BitVector operator+(const BitVector& a, const BitVector& b) {
 		BitVector result = a;
-		for (int i = 0; i < b.size(); ++i) {
-			if (b.test(i)) {
-				result.set(i);
-			}
-		}
+		bitkernels::orInto(result, b);
+		return result;
+	}
+
+	BitVector unionMeet(const BitVector& a, const BitVector& b) {
+		return a + b;
+	}
+
+	BitVector intersectionMeet(const BitVector& a, const BitVector& b) {
+		BitVector result = a;
+		bitkernels::andInto(bitkernels::words(result), bitkernels::words(b), bitkernels::numWords(result));
 		return result;
 	}
+
+	void printSolverStats(const SolverStats& stats, raw_ostream& OS) {
+		OS << "Iterations: " << stats.changedBoundaries << "\n";
+		OS << "Block visits: " << stats.blockVisits << "\n";
+		if (stats.uniqueStates != 0) {
+			OS << "State dedup: " << stats.stateRows << " states, " << stats.uniqueStates << " unique ("
+				<< format("%.2f", (double)stats.stateRows / stats.uniqueStates) << "x)\n";
+		}
+	}
 }
@@ -16,41 +16,141 @@
 #include "llvm/IR/Instructions.h"
 #include "llvm/ADT/SmallSet.h"
 #include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Optional.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/ValueMap.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "bitset-kernels.h"
+#include "dataflow-solver.h"
+#include "fused-dataflow.h"
+#include "state-store.h"
+
 namespace llvm {
 	// Difference operator for BitVector
 	llvm::BitVector operator-(const llvm::BitVector& a, const llvm::BitVector& b);
 	// Union operator for BitVector
 	llvm::BitVector operator+(const llvm::BitVector& a, const llvm::BitVector& b);
 
+	// Framework meet operators. An analysis built with one of these meets all neighbour boundaries
+	// of a block with a single n-ary bitset kernel call instead of calling the meet pairwise.
+	BitVector unionMeet(const BitVector& a, const BitVector& b);
+	BitVector intersectionMeet(const BitVector& a, const BitVector& b);
+
+	// Iteration strategy selected on the opt command line (-dataflow-strategy).
+	extern cl::opt<IterationStrategy> DataflowStrategy;
+	// Result mode and checkpoint interval selected on the opt command line
+	// (-dataflow-results, -dataflow-checkpoint-interval).
+	extern cl::opt<ResultMode> DataflowResultMode;
+	extern cl::opt<unsigned> DataflowCheckpointInterval;
+	// State representation selected on the opt command line (-dataflow-states).
+	extern cl::opt<StateRepresentation> DataflowStates;
+
+	// Solver policy built from std::function callbacks, used by DataflowAnalysis. The transfer function
+	// kind is picked at run time from the callback that was set; the framework meet operators are
+	// recognized and use the n-ary kernels.
+	template <bool Forward>
+	struct ErasedDataflowPolicy {
+		using MeetOperator = std::function<BitVector(const BitVector&, const BitVector&)>;
+		using TransferFunction = std::function<BitVector(BitVector, Instruction*)>;
+		using BlockTransferFunction = std::function<BitVector(BitVector, BasicBlock*, InstructionStateMap&)>;
+		using GenKillFunction = std::function<void(Instruction*, BitVector& gen, BitVector& kill)>;
+
+		static constexpr bool forward = Forward;
+		static constexpr TransferKind transferKind = TransferKind::Dynamic;
+
+		enum class MeetKind { Custom, Union, Intersection };
+
+		MeetOperator meetOperator;
+		MeetKind meetKind = MeetKind::Custom;
+		// Exactly one of blockTransferFunc, instTransferFunc and genKillFunc is set.
+		BlockTransferFunction blockTransferFunc;
+		TransferFunction instTransferFunc;
+		GenKillFunction genKillFunc;
+		bool entryInitValue = false;
+		bool outInitValue = false;
+
+		// Recognize the framework meet operators so meet() can use the n-ary kernels.
+		static MeetKind classifyMeet(const MeetOperator& meetOperator) {
+			using MeetFn = BitVector (*)(const BitVector&, const BitVector&);
+			if (const MeetFn* fn = meetOperator.template target<MeetFn>()) {
+				if (*fn == &unionMeet) return MeetKind::Union;
+				if (*fn == &intersectionMeet) return MeetKind::Intersection;
+			}
+			return MeetKind::Custom;
+		}
+
+		TransferKind dynamicTransferKind() const {
+			if (genKillFunc) return TransferKind::GenKill;
+			if (instTransferFunc) return TransferKind::Instruction;
+			return TransferKind::Block;
+		}
+
+		bool topValue() const { return outInitValue; }
+		bool boundaryValue() const { return entryInitValue; }
+
+		void meet(BitVector& state, ArrayRef<StateRef> inputs) const {
+			switch (meetKind) {
+				case MeetKind::Union:
+					UnionMeetPolicy::meet(state, inputs);
+					break;
+				case MeetKind::Intersection:
+					IntersectionMeetPolicy::meet(state, inputs);
+					break;
+				case MeetKind::Custom: {
+					for (const StateRef& input : inputs) {
+						state = meetOperator(state, input.toBitVector());
+					}
+					break;
+				}
+			}
+		}
+
+		void genKill(Instruction* I, BitVector& gen, BitVector& kill) const {
+			genKillFunc(I, gen, kill);
+		}
+
+		void transfer(BitVector& state, Instruction* I) const {
+			state = instTransferFunc(std::move(state), I);
+		}
+
+		BitVector transferBlock(BitVector state, BasicBlock* BB, InstructionStateMap& results) const {
+			return blockTransferFunc(std::move(state), BB, results);
+		}
+	};
+
 	// class Element is the element being analyzed. For instance, in reaching definition, Element is a definition.
 	// In available expressions, element is an expression. To use this class, you need to:
 	// (1) Define your own Element class for this analysis, and provide std::hash and equals operator for it.
 	// 		Element is constructed from Instruction* or Value*, so you can store Instruction* or Value* inside Element.
 	// (2) Provide lambda MeetOperator, Gen and Kill Function.
+	// The callbacks are called through std::function. Analyses on a hot path should implement a policy
+	// and use DataflowSolver directly, which inlines the meet and transfer functions into the solver.
 	template <class Element, bool Forward = true>
 	class DataflowAnalysis{
 
 		public:
 			// Result of Dataflow Analysis.
 			// ResultMap maps each instruction to bit vector state after processing that instruction.
-			using ResultMap = DenseMap<Instruction*, BitVector>;
+			using ResultMap = InstructionStateMap;
 			using BlockResultMap = DenseMap<BasicBlock*, BitVector>;
+			using Policy = ErasedDataflowPolicy<Forward>;
 			// Meet operator.
-			using MeetOperator = std::function<BitVector(const BitVector&, const BitVector&)>;
+			using MeetOperator = typename Policy::MeetOperator;
 
 			// Map from Element to its offset in BitVector, should be captured by GenFunc and KillFunc.
 			using BitVectorOffsetMap = DenseMap<Element, int>;
 			using OffsetToElementMap = DenseMap<int, Element>; // for printing
 			// Transfer function for a single instruction: state' = transfer(state, inst)
-			using TransferFunction = std::function<BitVector(BitVector, Instruction*)>;
-			using BlockTransferFunction = std::function<BitVector(BitVector,BasicBlock*,ResultMap&)>;
+			using TransferFunction = typename Policy::TransferFunction;
+			using BlockTransferFunction = typename Policy::BlockTransferFunction;
+			// Gen and kill sets of a single instruction, for transfers of the form state' = (state - kill) ∪ gen.
+			// gen and kill are passed in cleared and sized to the number of elements.
+			using GenKillFunction = typename Policy::GenKillFunction;
 
 			using InstToElementFunc = std::function<std::vector<Element>(Instruction*)>;
 
@@ -71,31 +171,9 @@ namespace llvm {
 			bool entryInit,
 			// TODO(optional): make outInit type trait of MeetOperator
 			bool outInit
-		):  
-			meetOperator_(meetOperator),
-			bitVectorSize_(numElements),
-			entryInitValue_(entryInit),
-			outInitValue_(outInit){
-				BlockTransferFunction btf = [transferFunction](BitVector in,BasicBlock* BB, ResultMap& resultMap)->BitVector{
-					BitVector out = in;
-					if constexpr (Forward) {
-						for (Instruction &I : *BB) {
-							out = transferFunction(out, &I);
-							resultMap[&I] = out;
-						}
-					} else {
-						for (auto it = BB->rbegin(); it != BB->rend(); ++it) {
-							Instruction &I = *it;
-							out = transferFunction(out, &I);
-							resultMap[&I] = out;
-						}
-					}
-					return out;
-
-				};
-				transferFunc_ = std::move(btf);
-
-			}
+		): solver_(makePolicy(meetOperator, entryInit, outInit), numElements) {
+			solver_.getPolicy().instTransferFunc = transferFunction;
+		}
 
 		DataflowAnalysis(
 			const MeetOperator& meetOperator,
@@ -104,11 +182,23 @@ namespace llvm {
 			bool entryInit,
 			// TODO(optional): make outInit type trait of MeetOperator
 			bool outInit
-		): meetOperator_(meetOperator),
-		transferFunc_(transferFunction),
-			bitVectorSize_(numElements),
-			entryInitValue_(entryInit),
-			outInitValue_(outInit) {};
+		): solver_(makePolicy(meetOperator, entryInit, outInit), numElements) {
+			solver_.getPolicy().blockTransferFunc = transferFunction;
+		}
+
+		// Block summary mode: genKillFunction is composed into one GEN/KILL pair per basic block before
+		// solving, so each block visit during the fixpoint iteration is a single fused bitvector transfer.
+		// Per-instruction states are replayed once, after convergence.
+		// @param genKillFunction: fills in the gen and kill set of one instruction.
+		DataflowAnalysis(
+			const MeetOperator& meetOperator,
+			const GenKillFunction& genKillFunction,
+			int numElements,
+			bool entryInit,
+			bool outInit
+		): solver_(makePolicy(meetOperator, entryInit, outInit), numElements) {
+			solver_.getPolicy().genKillFunc = genKillFunction;
+		}
 		
 		// Create BitVectorOffsetMap by iterating over all instructions in func and applying getElementsFromInstruction to each instruction.
 		// The returned BitVectorOffsetMap maps each Element to a unique offset in the BitVector.
@@ -121,8 +211,8 @@ namespace llvm {
 				for (Instruction& inst : bb) {
 					std::vector<Element> elements = getElementsFromInstruction(&inst);
 					for (Element& elem : elements) {
-						if (elementToOffset.find(elem) == elementToOffset.end()) {
-							elementToOffset[elem] = bitVectorSize;
+						// One probe per element: try_emplace only inserts unseen elements.
+						if (elementToOffset.try_emplace(elem, bitVectorSize).second) {
 							bitVectorSize++;
 						}
 					}
@@ -131,96 +221,157 @@ namespace llvm {
 			return std::move(elementToOffset);
 		}
 
+		// See DataflowSolver::setIterationStrategy.
+		void setIterationStrategy(IterationStrategy strategy) {
+			solver_.setIterationStrategy(strategy);
+		}
+
+		// See DataflowSolver::setResultMode. In lazy mode analyze() leaves the ResultMap empty.
+		void setResultMode(ResultMode mode, unsigned checkpointInterval = 0) {
+			solver_.setResultMode(mode, checkpointInterval);
+		}
+
+		ResultMode getResultMode() const {
+			return solver_.getResultMode();
+		}
+
+		// See DataflowSolver::setStateRepresentation.
+		void setStateRepresentation(StateRepresentation representation) {
+			solver_.setStateRepresentation(representation);
+		}
+
+		// This analysis as a problem that a FusedDataflow bundle (fused-dataflow.h) solves together with other
+		// problems of the same direction. Needs a GenKillFunction and one of the framework meets, started
+		// from its identity (outInit false for unionMeet, true for intersectionMeet).
+		DataflowProblem toProblem(std::string name) const {
+			const Policy& policy = solver_.getPolicy();
+			assert(policy.genKillFunc && "only gen/kill analyses can be fused");
+			assert(policy.meetKind != Policy::MeetKind::Custom && "fused problems use the framework meets");
+			bool intersection = policy.meetKind == Policy::MeetKind::Intersection;
+			assert(policy.outInitValue == intersection && "outInit must be the identity of the meet");
+			DataflowProblem problem;
+			problem.name = std::move(name);
+			problem.forward = Forward;
+			problem.meet = intersection ? DataflowProblem::Meet::Intersection : DataflowProblem::Meet::Union;
+			problem.boundaryValue = policy.entryInitValue;
+			problem.numElements = solver_.numElements();
+			problem.genKill = policy.genKillFunc;
+			return problem;
+		}
+
+		// See DataflowSolver::stateAt. Analyses built from a BlockTransferFunction only have
+		// per-instruction states in the ResultMap / lookupState().
+		Optional<BitVector> stateAt(Instruction* I) const {
+			return solver_.stateAt(I);
+		}
+
+		// See DataflowSolver::lookupState.
+		Optional<BitVector> lookupState(Instruction* I) const {
+			return solver_.lookupState(I);
+		}
+
+		// Block boundaries, block inputs and stored per-instruction states of the last solve.
+		const StateStore& getStates() const {
+			return solver_.getStates();
+		}
+
+		// Free the state store and all other per-function state of the last solve.
+		void releaseStates() {
+			solver_.releaseStates();
+		}
+
+		// Counters collected by the last call to analyze().
+		const SolverStats& getStats() const {
+			return solver_.getStats();
+		}
+
+		// Perform forward/backward dataflow analysis on the given function. States are kept in the analysis'
+		// StateStore and queried with stateAt() / lookupState() / getStates().
+		// solve() only touches this object and reads the IR, so different DataflowAnalysis objects can solve
+		// different functions concurrently.
+		const StateStore& solve(Function& func, const OffsetToElementMap& map){
+			assert((int)map.size() == solver_.numElements());
+			return solver_.solve(func);
+		}
+
+		// Re-converge after local edits of func, keeping the boundaries of the last solve. See
+		// DataflowSolver::update. map is the offset map after the edit: existing elements keep their
+		// offsets and new elements are appended, which grows the universe in place.
+		const StateStore& update(Function& func, ArrayRef<BasicBlock*> invalidated, const OffsetToElementMap& map) {
+			return solver_.update(func, invalidated, map.size());
+		}
+
 		// Perform forward/backward dataflow analysis on the given function and return per-instruction states.
+		// Kept for compatibility: copies the state store of solve() into maps.
 		std::pair<ResultMap,BlockResultMap> analyze(Function& func, const OffsetToElementMap& map){
-			assert(map.size() == bitVectorSize_);
-			std::vector<BasicBlock*> PostOrder(po_begin(&func), po_end(&func));
-			// Now iterate in reverse (which gives you RPO)
-			if constexpr (!Forward){
-				outs()<<"Running backward analysis\n";
-				std::reverse(PostOrder.begin(), PostOrder.end());
+			const StateStore& states = solve(func, map);
+			ResultMap resultMap = solver_.takeBlockTransferResults();
+			for (unsigned i = 0; i < states.numInstructions(); ++i) {
+				if (getResultMode() == ResultMode::Eager) {
+					resultMap[states.instructions()[i]] = states.instructionState(i).toBitVector();
+				}
 			}
-
-			// Maintain per-basic-block boundary sets internally:
-			// Forward: OUT[BB]; Backward: IN[BB]
 			BlockResultMap blockBoundaryMap;
-			ResultMap resultMap;
-			bool changed;
-			int iterations =0;
-        do {
-            changed = false;
-            for (auto *BB : PostOrder) {
-
-				BitVector& oldBoundary = blockBoundaryMap.try_emplace(
-					BB, BitVector(bitVectorSize_, outInitValue_)
-				).first->second;
-				// Initialize to TOP: TOP meet X = X
-				BitVector state;
-				if constexpr (Forward) {
-					if (pred_empty(BB)) {
-						// entry block init
-						state = BitVector(bitVectorSize_, entryInitValue_);
-					} else {
-						state = BitVector(bitVectorSize_, outInitValue_);
-						for (auto *Pred : predecessors(BB)) {
-							auto [it, inserted] = blockBoundaryMap.try_emplace(Pred, BitVector(bitVectorSize_, outInitValue_));
-							BitVector &predOut = it->second;
-							state = meetOperator_(state, predOut);
-						}
-					}
-				} else {
-					if (succ_empty(BB)) {
-						// exit block init
-						state = BitVector(bitVectorSize_, entryInitValue_);
-					} else {
-						state = BitVector(bitVectorSize_, outInitValue_);
-						for (auto *Succ : successors(BB)) {
-							auto [it, inserted] = blockBoundaryMap.try_emplace(Succ, BitVector(bitVectorSize_, outInitValue_));
-							BitVector &succIn = it->second;
-							state = meetOperator_(state, succIn);
-						}
-					}
-				}
-				// Walk instructions and apply transfer per instruction
-
-				BitVector newBoundary = transferFunc_(state,BB,resultMap);
-				if(newBoundary!=oldBoundary){
-					changed = true;
-					blockBoundaryMap[BB] = std::move(newBoundary);
-					iterations++;
-				}
-            }
-        } while (changed);
-			outs()<<"Iterations: "<<iterations<<"\n";
+			for (unsigned b = 0; b < states.numBlocks(); ++b) {
+				blockBoundaryMap[states.blocks()[b]] = states.boundaryState(b).toBitVector();
+			}
 			return {std::move(resultMap),std::move(blockBoundaryMap)};
 		}
-		
+
 		private:
-			MeetOperator meetOperator_;
-			BlockTransferFunction transferFunc_;
-			int bitVectorSize_;
-			bool entryInitValue_;
-			bool outInitValue_;
+			static Policy makePolicy(const MeetOperator& meetOperator, bool entryInit, bool outInit) {
+				Policy policy;
+				policy.meetOperator = meetOperator;
+				policy.meetKind = Policy::classifyMeet(meetOperator);
+				policy.entryInitValue = entryInit;
+				policy.outInitValue = outInit;
+				return policy;
+			}
+
+			DataflowSolver<Policy> solver_;
 	};
 
+	// Print the solver counters as "Iterations: <changed boundaries>" and "Block visits: <visits>", plus
+	// "State dedup: <rows> states, <distinct> unique (<ratio>x)" for interned state stores.
+	void printSolverStats(const SolverStats& stats, raw_ostream& OS = outs());
+
 	template <class Element>
 	void printBitVector(const BitVector &vec,
-						const DenseMap<int, Element> &map) {
-		outs() << "{";
+						const DenseMap<int, Element> &map,
+						raw_ostream &OS = outs()) {
+		OS << "{";
 		bool first = true;
 		for (int i : vec.set_bits()) {
 			if (vec.test(i)) {
-				if (!first) outs() << ", ";
+				if (!first) OS << ", ";
 				 if constexpr (std::is_pointer<Element>()) {
-					outs() << *map.lookup(i);
+					OS << *map.lookup(i);
 				} else {
-					outs() << map.lookup(i).toString();
+					OS << map.lookup(i).toString();
 				}
 
 				first = false;
 			}
 		}
-		outs() << "}\n";
+		OS << "}\n";
+	}
+
+	template <class Element>
+	void printBitVector(StateRef vec,
+						const DenseMap<int, Element> &map,
+						raw_ostream &OS = outs()) {
+		OS << "{";
+		bool first = true;
+		vec.forEachSetBit([&](unsigned i) {
+			if (!first) OS << ", ";
+			if constexpr (std::is_pointer<Element>()) {
+				OS << *map.lookup(i);
+			} else {
+				OS << map.lookup(i).toString();
+			}
+			first = false;
+		});
+		OS << "}\n";
 	}
 }
 
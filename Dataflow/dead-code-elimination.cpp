@@ -0,0 +1,236 @@
+// 15-745 Assignment 2: dead-code-elimination.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <memory>
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/Support/Format.h"
+
+#include "dead-code-elimination.h"
+#include "liveness-support.h"
+
+#define DEBUG_TYPE "liveness-dce"
+
+namespace llvm {
+	STATISTIC(NumDeadInstructions, "Number of dead instructions removed, PHIs included");
+	STATISTIC(NumDeadPhis, "Number of dead PHIs removed");
+
+	static cl::opt<bool> VerifyUpdates("liveness-dce-verify", cl::Hidden,
+		cl::desc("Check liveness after every incremental update of -liveness-dce against a fresh solve"));
+
+	namespace {
+		// Dense liveness of one function, kept up to date while instructions are removed.
+		class DeadCodeEliminator {
+			public:
+				explicit DeadCodeEliminator(Function& F) : F(F) {}
+
+				DeadCodeStats run();
+
+			private:
+				// Build the alias sets and the variables of F as it is now, and solve liveness from scratch.
+				void solve();
+				// A liveness solver over the current alias sets and variables, with the solver options of the
+				// opt command line.
+				std::unique_ptr<DataflowSolver<LivenessPolicy>> makeSolver() const;
+				// Whether every block boundary, block input and instruction state of solver is the same as
+				// after a fresh solve over the same alias sets and variables.
+				bool matchesFreshSolve() const;
+				// Replace candidates with all instructions of F.
+				void addAllInstructions(SmallSetVector<Instruction*, 16>& candidates) const;
+				bool isReached(BasicBlock* BB) const { return solver->getStates().blockIndex(BB) >= 0; }
+				// I computes a variable without side effects, and nothing reads it or the variable is not live
+				// right after I.
+				bool isDead(Instruction* I) const;
+
+				Function& F;
+				PhiAliasResolver aliases;
+				LivenessDataflow::BitVectorOffsetMap offsetMap;
+				std::unique_ptr<DataflowSolver<LivenessPolicy>> solver;
+		};
+
+		void DeadCodeEliminator::solve() {
+			solver.reset();
+			aliases = PhiAliasResolver(F);
+			offsetMap = createLivenessOffsets(F, aliases);
+			solver = makeSolver();
+			solver->solve(F);
+		}
+
+		std::unique_ptr<DataflowSolver<LivenessPolicy>> DeadCodeEliminator::makeSolver() const {
+			auto result = std::make_unique<DataflowSolver<LivenessPolicy>>(LivenessPolicy(aliases, offsetMap),
+				offsetMap.size());
+			result->setIterationStrategy(DataflowStrategy);
+			result->setResultMode(DataflowResultMode, DataflowCheckpointInterval);
+			result->setStateRepresentation(DataflowStates);
+			return result;
+		}
+
+		bool DeadCodeEliminator::matchesFreshSolve() const {
+			std::unique_ptr<DataflowSolver<LivenessPolicy>> fresh = makeSolver();
+			fresh->solve(F);
+			const StateStore& updated = solver->getStates();
+			const StateStore& expected = fresh->getStates();
+			for (BasicBlock& BB : F) {
+				int b = updated.blockIndex(&BB), e = expected.blockIndex(&BB);
+				if ((b < 0) != (e < 0)) {
+					return false;
+				}
+				if (b < 0) {
+					continue;
+				}
+				if (updated.boundaryState(b).toBitVector() != expected.boundaryState(e).toBitVector() ||
+					updated.inputState(b).toBitVector() != expected.inputState(e).toBitVector()) {
+					return false;
+				}
+				for (Instruction& I : BB) {
+					if (solver->lookupState(&I) != fresh->lookupState(&I)) {
+						return false;
+					}
+				}
+			}
+			return true;
+		}
+
+		void DeadCodeEliminator::addAllInstructions(SmallSetVector<Instruction*, 16>& candidates) const {
+			candidates.clear();
+			for (Instruction& I : instructions(F)) {
+				candidates.insert(&I);
+			}
+		}
+
+		bool DeadCodeEliminator::isDead(Instruction* I) const {
+			if (I->isTerminator() || I->isEHPad() || I->getType()->isVoidTy() || I->mayHaveSideEffects()) {
+				return false;
+			}
+			auto offset = offsetMap.find(Var(aliases.lookup(I)));
+			if (offset == offsetMap.end()) {
+				return false;
+			}
+			// Unreachable code is left alone.
+			Optional<BitVector> after = solver->lookupState(I->getNextNode());
+			if (!after) {
+				return false;
+			}
+			// The variable is the whole alias set of I, whose liveness over-approximates that of each
+			// member: a member nothing reads is dead even while its set is live.
+			return I->use_empty() || !after->test(offset->second);
+		}
+
+		DeadCodeStats DeadCodeEliminator::run() {
+			DeadCodeStats stats;
+			solve();
+			stats.rounds = stats.solves = 1;
+			// Whether a removed PHI is still merged into the alias sets, which are then coarser than those of
+			// F as it is now. Liveness stays safe to use, but a coarser variable can keep a dead value live.
+			bool staleAliases = false;
+			SmallSetVector<Instruction*, 16> candidates;
+			addAllInstructions(candidates);
+			while (true) {
+				SmallPtrSet<Instruction*, 16> dead;
+				for (Instruction* I : candidates) {
+					if (isDead(I)) {
+						dead.insert(I);
+					}
+				}
+				// Keep the instructions still read by a reachable user that stays.
+				for (bool pruned = true; pruned;) {
+					pruned = false;
+					for (Instruction* I : candidates) {
+						if (!dead.count(I)) {
+							continue;
+						}
+						for (User* U : I->users()) {
+							Instruction* user = cast<Instruction>(U);
+							if (!dead.count(user) && isReached(user->getParent())) {
+								dead.erase(I);
+								pruned = true;
+								break;
+							}
+						}
+					}
+				}
+
+				SmallSetVector<Instruction*, 16> next;
+				SmallSetVector<BasicBlock*, 16> edited;
+				// Operands of the removed instructions are the candidates of the next round.
+				for (Instruction* I : candidates) {
+					if (!dead.count(I)) {
+						continue;
+					}
+					for (Value* operand : I->operand_values()) {
+						Instruction* def = dyn_cast<Instruction>(operand);
+						if (def && !dead.count(def)) {
+							next.insert(def);
+						}
+					}
+					edited.insert(I->getParent());
+					I->replaceAllUsesWith(PoisonValue::get(I->getType()));
+				}
+				for (Instruction* I : candidates) {
+					if (!dead.count(I)) {
+						continue;
+					}
+					staleAliases |= isa<PHINode>(I);
+					stats.phis += isa<PHINode>(I);
+					++stats.instructions;
+					I->eraseFromParent();
+				}
+				candidates = std::move(next);
+				if (candidates.empty() && !staleAliases) {
+					break;
+				}
+				++stats.rounds;
+				if (!candidates.empty()) {
+					// Removals only change the transfer functions of their blocks. Removed PHIs stay in the
+					// alias sets for now, so the variables are unchanged and update() applies.
+					solver->update(F, edited.getArrayRef());
+					if (VerifyUpdates && !matchesFreshSolve()) {
+						F.getContext().emitError("liveness-dce: liveness after the incremental update of round " +
+							Twine(stats.rounds) + " of " + F.getName() + " differs from a fresh solve");
+						return stats;
+					}
+					continue;
+				}
+				// Nothing more is dead under the coarse alias sets: split them once, solve again and check
+				// every instruction.
+				solve();
+				++stats.solves;
+				staleAliases = false;
+				addAllInstructions(candidates);
+			}
+			return stats;
+		}
+	}
+
+	DeadCodeStats eliminateDeadCode(Function& F) {
+		auto start = std::chrono::steady_clock::now();
+		DeadCodeStats stats = DeadCodeEliminator(F).run();
+		stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		NumDeadInstructions += stats.instructions;
+		NumDeadPhis += stats.phis;
+		return stats;
+	}
+
+	void printDeadCodeStats(const Function& F, const DeadCodeStats& stats, raw_ostream& OS) {
+		OS << F.getName() << ": removed " << stats.instructions << " dead instructions (" << stats.phis
+			<< " PHIs) in " << stats.rounds << " rounds (" << stats.solves << " full solves), "
+			<< format("%.3f", stats.seconds * 1000) << " ms\n";
+	}
+
+	PreservedAnalyses DeadCodeEliminationPass::run(Function& F, FunctionAnalysisManager&) {
+		DeadCodeStats stats = eliminateDeadCode(F);
+		printDeadCodeStats(F, stats, OS);
+		if (stats.instructions == 0) {
+			return PreservedAnalyses::all();
+		}
+		PreservedAnalyses PA;
+		PA.preserveSet<CFGAnalyses>();
+		return PA;
+	}
+}
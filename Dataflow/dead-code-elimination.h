@@ -0,0 +1,52 @@
+// 15-745 Assignment 2: dead-code-elimination.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DEAD_CODE_ELIMINATION_H__
+#define __DEAD_CODE_ELIMINATION_H__
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+	// Counters of one eliminateDeadCode() run.
+	struct DeadCodeStats {
+		// Removed instructions, PHIs included, and the PHIs among them.
+		unsigned instructions = 0;
+		unsigned phis = 0;
+		// Liveness computations: one per round. solves of them are full solves, the others are incremental
+		// updates.
+		unsigned rounds = 0;
+		unsigned solves = 0;
+		// Wall time of the whole run, liveness included.
+		double seconds = 0;
+	};
+
+	// Remove the side-effect-free instructions of F, PHIs included, whose variable is dead right after
+	// them, using the dense liveness solver. The variable of a value is its PHI alias set, so a value
+	// without users is dead as well, even while other members keep the set live. Removing an instruction
+	// can make its operands dead, so elimination cascades in rounds. Each round only re-checks the operands
+	// of the instructions removed in the previous one, and re-converges liveness with
+	// DataflowSolver::update() over the edited blocks instead of solving again. Removed PHIs stay in the
+	// coarser alias sets of the last solve until a round finds nothing more; the sets are then rebuilt,
+	// liveness is solved again and every instruction is checked once more. PHI alias sets can make a value
+	// look dead while it is still read, so an instruction is only removed if each of its users is removed
+	// as well or is unreachable. Unreachable users get poison.
+	DeadCodeStats eliminateDeadCode(Function& F);
+
+	// Write "<function>: removed N dead instructions (P PHIs) in R rounds (S full solves), T ms" to OS.
+	void printDeadCodeStats(const Function& F, const DeadCodeStats& stats, raw_ostream& OS);
+
+	// opt -passes=liveness-dce: eliminates dead code in every function and prints its counters to OS.
+	class DeadCodeEliminationPass : public PassInfoMixin<DeadCodeEliminationPass> {
+		public:
+			explicit DeadCodeEliminationPass(raw_ostream& OS) : OS(OS) {}
+			PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			raw_ostream& OS;
+	};
+}
+
+#endif
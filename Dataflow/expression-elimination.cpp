@@ -0,0 +1,109 @@
+// 15-745 Assignment 2: expression-elimination.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Transforms/Utils/SSAUpdater.h"
+
+#include "expression-elimination.h"
+
+#define DEBUG_TYPE "available-elim"
+
+namespace llvm {
+	STATISTIC(NumRedundantExpressions, "Number of redundant expressions removed");
+
+	namespace {
+		// All computations of one canonical expression, in program order.
+		struct Computations {
+			// Operands of the first computation, in canonical order.
+			Expression operands;
+			// False once two computations use different values, e.g. two members of a PHI alias set.
+			bool sameOperands = true;
+			bool anyRedundant = false;
+			SmallVector<BinaryOperator*, 4> instructions;
+		};
+	}
+
+	unsigned eliminateRedundantExpressions(Function& F, const AvailableExpressionsInfo& available) {
+		const ExpressionCanonicalizer& canonicalize = available.getCanonicalizer();
+		std::vector<Computations> expressions(available.getNumExpressions());
+		SmallPtrSet<Instruction*, 16> redundant;
+		for (BasicBlock& BB : F) {
+			for (Instruction& I : BB) {
+				BinaryOperator* BO = dyn_cast<BinaryOperator>(&I);
+				if (!BO) {
+					continue;
+				}
+				int offset = available.getOffset(Expression(BO));
+				assert(offset >= 0 && "every BinaryOperator has an offset");
+				Computations& computations = expressions[offset];
+				Expression operands = canonicalize.order(Expression(BO));
+				if (computations.instructions.empty()) {
+					computations.operands = operands;
+				} else if (!(computations.operands == operands)) {
+					computations.sameOperands = false;
+				}
+				computations.instructions.push_back(BO);
+				Optional<BitVector> before = available.getAvailableBefore(BO);
+				if (before && before->test(offset)) {
+					redundant.insert(BO);
+					computations.anyRedundant = true;
+				}
+			}
+		}
+
+		unsigned removed = 0;
+		for (Computations& computations : expressions) {
+			if (!computations.sameOperands || !computations.anyRedundant) {
+				continue;
+			}
+			// The kept computations define the value; on every path into a redundant one, the last kept
+			// computation comes after the last redefinition of an operand, so SSA construction from the
+			// kept ones yields the value of the redundant one.
+			BinaryOperator* first = computations.instructions.front();
+			SSAUpdater updater;
+			updater.Initialize(first->getType(), first->getName());
+			SmallVector<BinaryOperator*, 4> kept;
+			for (BinaryOperator* BO : computations.instructions) {
+				if (!redundant.count(BO)) {
+					updater.AddAvailableValue(BO->getParent(), BO);
+					kept.push_back(BO);
+				}
+			}
+			DenseMap<BasicBlock*, Value*> current;
+			for (BinaryOperator* BO : computations.instructions) {
+				BasicBlock* BB = BO->getParent();
+				if (!redundant.count(BO)) {
+					current[BB] = BO;
+					continue;
+				}
+				Value*& value = current[BB];
+				if (!value) {
+					value = updater.GetValueInMiddleOfBlock(BB);
+				}
+				// A kept computation may now also stand for one without nsw, nuw, exact or fast-math flags.
+				for (BinaryOperator* keptBO : kept) {
+					keptBO->andIRFlags(BO);
+				}
+				BO->replaceAllUsesWith(value);
+				BO->eraseFromParent();
+				++removed;
+			}
+		}
+		NumRedundantExpressions += removed;
+		return removed;
+	}
+
+	PreservedAnalyses RedundantExpressionEliminationPass::run(Function& F, FunctionAnalysisManager& FAM) {
+		unsigned removed = eliminateRedundantExpressions(F, FAM.getResult<AvailableExpressionsAnalysis>(F));
+		OS << F.getName() << ": removed " << removed << " redundant expressions\n";
+		if (removed == 0) {
+			return PreservedAnalyses::all();
+		}
+		PreservedAnalyses PA;
+		PA.preserveSet<CFGAnalyses>();
+		return PA;
+	}
+}
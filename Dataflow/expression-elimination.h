@@ -0,0 +1,36 @@
+// 15-745 Assignment 2: expression-elimination.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __EXPRESSION_ELIMINATION_H__
+#define __EXPRESSION_ELIMINATION_H__
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "available-support.h"
+
+namespace llvm {
+	// Remove the BinaryOperators of F whose canonical expression is available right before them, and
+	// return how many were removed. A removed instruction is replaced by the earlier computation that
+	// reaches it, or by PHIs of the computations on the paths into it. PHI aliasing makes a canonical
+	// expression stand for computations of different values, so an expression is only eliminated when
+	// all its computations in F use the same operands. The IR flags of the remaining computations are
+	// intersected with those of the removed ones. available must have been computed on F as it is now;
+	// it is stale once this returns a non-zero count.
+	unsigned eliminateRedundantExpressions(Function& F, const AvailableExpressionsInfo& available);
+
+	// opt -passes=available-elim: eliminates redundant expressions with the AvailableExpressionsAnalysis
+	// result and writes the number of removed instructions of each function to OS.
+	class RedundantExpressionEliminationPass : public PassInfoMixin<RedundantExpressionEliminationPass> {
+		public:
+			explicit RedundantExpressionEliminationPass(raw_ostream& OS) : OS(OS) {}
+			PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			raw_ostream& OS;
+	};
+}
+
+#endif
@@ -0,0 +1,125 @@
+// 15-745 Assignment 2: fused-dataflow.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+
+#include "dataflow.h"
+#include "fused-dataflow.h"
+
+namespace llvm {
+	unsigned ProblemBundle::add(DataflowProblem problem) {
+		assert(problem.genKill && "a fused problem needs a gen/kill function");
+		unsigned index = problems_.size();
+		segments_.push_back({size_, problem.numElements, problem.meet == DataflowProblem::Meet::Intersection});
+		size_ += alignTo(problem.numElements, bitkernels::WordBits);
+		gen_.emplace_back(problem.numElements);
+		kill_.emplace_back(problem.numElements);
+		problems_.push_back(std::move(problem));
+		return index;
+	}
+
+	void ProblemBundle::boundaryState(BitVector& state) const {
+		assert(state.size() == size_);
+		state.reset();
+		for (unsigned p = 0; p < problems_.size(); ++p) {
+			const Segment& segment = segments_[p];
+			if (problems_[p].boundaryValue != segment.complemented) {
+				state.set(segment.offset, segment.offset + segment.size);
+			}
+		}
+	}
+
+	void ProblemBundle::genKill(Instruction* I, BitVector& gen, BitVector& kill) const {
+		for (unsigned p = 0; p < problems_.size(); ++p) {
+			const Segment& segment = segments_[p];
+			if (segment.size == 0) {
+				continue;
+			}
+			BitVector& problemGen = gen_[p];
+			BitVector& problemKill = kill_[p];
+			problemGen.reset();
+			problemKill.reset();
+			problems_[p].genKill(I, problemGen, problemKill);
+			// A complemented segment gens what the problem kills and kills what it gens.
+			const BitVector& storedGen = segment.complemented ? problemKill : problemGen;
+			const BitVector& storedKill = segment.complemented ? problemGen : problemKill;
+			unsigned word = segment.offset / bitkernels::WordBits;
+			size_t bytes = bitkernels::numWords(storedGen) * sizeof(bitkernels::Word);
+			std::memcpy(bitkernels::words(gen) + word, bitkernels::words(storedGen), bytes);
+			std::memcpy(bitkernels::words(kill) + word, bitkernels::words(storedKill), bytes);
+		}
+	}
+
+	BitVector ProblemBundle::extract(unsigned p, const BitVector& wide) const {
+		assert(wide.size() == size_);
+		const Segment& segment = segments_[p];
+		BitVector state(segment.size);
+		if (segment.size != 0) {
+			std::memcpy(bitkernels::words(state), bitkernels::words(wide) + segment.offset / bitkernels::WordBits,
+				bitkernels::numWords(state) * sizeof(bitkernels::Word));
+		}
+		if (segment.complemented) {
+			state.flip();
+		}
+		return state;
+	}
+
+	FusedDataflowDriver::Handle FusedDataflowDriver::addProblem(DataflowProblem problem) {
+		if (problem.forward) {
+			return {true, forward_.addProblem(std::move(problem))};
+		}
+		return {false, backward_.addProblem(std::move(problem))};
+	}
+
+	void FusedDataflowDriver::solve(Function& func) {
+		auto solveBundle = [&](auto& bundle) {
+			if (bundle.empty()) {
+				return;
+			}
+			bundle.setIterationStrategy(DataflowStrategy);
+			bundle.setResultMode(DataflowResultMode, DataflowCheckpointInterval);
+			bundle.setStateRepresentation(DataflowStates);
+			bundle.solve(func);
+		};
+		solveBundle(forward_);
+		solveBundle(backward_);
+	}
+
+	Optional<BitVector> FusedDataflowDriver::stateAt(Handle problem, Instruction* I) const {
+		return problem.forward ? forward_.stateAt(problem.index, I) : backward_.stateAt(problem.index, I);
+	}
+
+	Optional<BitVector> FusedDataflowDriver::boundaryState(Handle problem, BasicBlock* BB) const {
+		return problem.forward ? forward_.boundaryState(problem.index, BB) : backward_.boundaryState(problem.index, BB);
+	}
+
+	Optional<BitVector> FusedDataflowDriver::inputState(Handle problem, BasicBlock* BB) const {
+		return problem.forward ? forward_.inputState(problem.index, BB) : backward_.inputState(problem.index, BB);
+	}
+
+	SolverStats FusedDataflowDriver::getStats() const {
+		SolverStats total;
+		auto add = [&](const SolverStats& stats) {
+			total.blockVisits += stats.blockVisits;
+			total.changedBoundaries += stats.changedBoundaries;
+			total.components += stats.components;
+			total.componentIterations += stats.componentIterations;
+			total.meets += stats.meets;
+			total.transfers += stats.transfers;
+			total.universe += stats.universe;
+			total.bytesAllocated += stats.bytesAllocated;
+			total.sparseStates += stats.sparseStates;
+			total.complementStates += stats.complementStates;
+			total.stateRows += stats.stateRows;
+			total.uniqueStates += stats.uniqueStates;
+		};
+		if (!forward_.empty()) {
+			add(forward_.getStats());
+		}
+		if (!backward_.empty()) {
+			add(backward_.getStats());
+		}
+		return total;
+	}
+}
@@ -0,0 +1,208 @@
+// 15-745 Assignment 2: fused-dataflow.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __FUSED_DATAFLOW_H__
+#define __FUSED_DATAFLOW_H__
+
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+
+#include "dataflow-solver.h"
+
+namespace llvm {
+	// One gen/kill bitvector problem that can be solved together with others: state' = (state - kill) ∪ gen
+	// over numElements bits, met with the union or the intersection of the neighbours.
+	struct DataflowProblem {
+		using GenKillFunction = std::function<void(Instruction*, BitVector& gen, BitVector& kill)>;
+		enum class Meet { Union, Intersection };
+
+		std::string name;
+		bool forward = true;
+		Meet meet = Meet::Union;
+		// Input of the entry (forward) or exit (backward) blocks.
+		bool boundaryValue = false;
+		unsigned numElements = 0;
+		// Fills in the gen and kill set of one instruction; both are passed in cleared and sized to numElements.
+		GenKillFunction genKill;
+	};
+
+	// Same-direction problems packed side by side into one wide state. Every problem owns a segment that
+	// starts on a word boundary, so segments are moved with whole-word copies. Intersection problems are
+	// stored complemented: the complement of (state - kill) ∪ gen is (complement - gen) ∪ kill, and the
+	// complement of an intersection is the union of the complements. So every segment is met by union from
+	// the empty set, and the whole wide state goes through one n-ary union kernel call per meet.
+	class ProblemBundle {
+		public:
+			struct Segment {
+				// First bit of the segment in the wide state.
+				unsigned offset;
+				unsigned size;
+				bool complemented;
+			};
+
+			// Append a problem and return its index.
+			unsigned add(DataflowProblem problem);
+
+			unsigned numProblems() const { return problems_.size(); }
+			const DataflowProblem& problem(unsigned p) const { return problems_[p]; }
+			const Segment& segment(unsigned p) const { return segments_[p]; }
+			// Bits of the wide state, padding included.
+			unsigned size() const { return size_; }
+
+			// Set the wide state (sized to size()) to the boundary value of every problem, in stored form.
+			void boundaryState(BitVector& state) const;
+			// Wide gen/kill sets of I (cleared and sized to size()) from the gen/kill functions of all problems.
+			// Uses per-problem scratch sets, so a bundle is used by one solve at a time.
+			void genKill(Instruction* I, BitVector& gen, BitVector& kill) const;
+			// The state of problem p held in a wide state.
+			BitVector extract(unsigned p, const BitVector& wide) const;
+
+		private:
+			std::vector<DataflowProblem> problems_;
+			std::vector<Segment> segments_;
+			unsigned size_ = 0;
+			mutable std::vector<BitVector> gen_;
+			mutable std::vector<BitVector> kill_;
+	};
+
+	// Solver policy of a bundle: union meet over the wide state, gen/kill transfer of all problems.
+	template <bool Forward>
+	struct FusedPolicy : UnionMeetPolicy {
+		static constexpr bool forward = Forward;
+		static constexpr TransferKind transferKind = TransferKind::GenKill;
+		static constexpr bool boundaryValue() { return false; }
+
+		explicit FusedPolicy(const ProblemBundle& bundle) : bundle(&bundle) {}
+
+		void boundaryState(BitVector& state) const { bundle->boundaryState(state); }
+		void genKill(Instruction* I, BitVector& gen, BitVector& kill) const { bundle->genKill(I, gen, kill); }
+
+		const ProblemBundle* bundle;
+	};
+
+	// Same-direction gen/kill problems solved together by one DataflowSolver: one postorder, one worklist,
+	// one state store and one set of block lookups for all of them. Every block visit applies the gen/kill
+	// summaries of all problems with one fused kernel call. Results are the same as solving each problem
+	// on its own.
+	template <bool Forward>
+	class FusedDataflow {
+		public:
+			using Solver = DataflowSolver<FusedPolicy<Forward>>;
+
+			// Add a problem of this direction before the first solve() and return its index.
+			unsigned addProblem(DataflowProblem problem) {
+				assert(problem.forward == Forward && "a bundle only holds problems of its direction");
+				assert(!solver_ && "problems must be added before solving");
+				return bundle_.add(std::move(problem));
+			}
+
+			const ProblemBundle& getBundle() const { return bundle_; }
+			bool empty() const { return bundle_.numProblems() == 0; }
+
+			// Solver options, see DataflowSolver. They apply to the next solve().
+			void setIterationStrategy(IterationStrategy strategy) { strategy_ = strategy; }
+			void setResultMode(ResultMode mode, unsigned checkpointInterval = 0) {
+				resultMode_ = mode;
+				checkpointInterval_ = checkpointInterval;
+			}
+			void setStateRepresentation(StateRepresentation representation) { representation_ = representation; }
+
+			// Solve all problems of the bundle on func.
+			void solve(Function& func) {
+				if (!solver_) {
+					solver_ = std::make_unique<Solver>(FusedPolicy<Forward>(bundle_), bundle_.size());
+				}
+				solver_->setIterationStrategy(strategy_);
+				solver_->setResultMode(resultMode_, checkpointInterval_);
+				solver_->setStateRepresentation(representation_);
+				solver_->solve(func);
+			}
+
+			// State of problem p after I, or None if I was not reached by the last solve.
+			Optional<BitVector> stateAt(unsigned p, Instruction* I) const {
+				assert(solver_ && "solve() must run before the states are queried");
+				Optional<BitVector> wide = solver_->stateAt(I);
+				if (!wide) {
+					return None;
+				}
+				return bundle_.extract(p, *wide);
+			}
+
+			// Block boundary (forward: OUT, backward: IN) and block input (the meet of the neighbours) of
+			// problem p, or None if BB was not reached.
+			Optional<BitVector> boundaryState(unsigned p, BasicBlock* BB) const {
+				assert(solver_ && "solve() must run before the states are queried");
+				int block = solver_->getStates().blockIndex(BB);
+				if (block < 0) {
+					return None;
+				}
+				return bundle_.extract(p, solver_->getStates().boundaryState(block).toBitVector());
+			}
+			Optional<BitVector> inputState(unsigned p, BasicBlock* BB) const {
+				assert(solver_ && "solve() must run before the states are queried");
+				int block = solver_->getStates().blockIndex(BB);
+				if (block < 0) {
+					return None;
+				}
+				return bundle_.extract(p, solver_->getStates().inputState(block).toBitVector());
+			}
+
+			// Counters of the last solve, for all problems together.
+			const SolverStats& getStats() const {
+				assert(solver_ && "solve() must run before the counters are queried");
+				return solver_->getStats();
+			}
+
+		private:
+			ProblemBundle bundle_;
+			std::unique_ptr<Solver> solver_;
+			IterationStrategy strategy_ = IterationStrategy::Worklist;
+			ResultMode resultMode_ = ResultMode::Eager;
+			unsigned checkpointInterval_ = 0;
+			StateRepresentation representation_ = StateRepresentation::Dense;
+	};
+
+	// Groups problems by direction into a forward and a backward bundle, and solves each non-empty bundle
+	// with one traversal of the function.
+	class FusedDataflowDriver {
+		public:
+			// A problem added to the driver: its bundle and its index in the bundle.
+			struct Handle {
+				bool forward;
+				unsigned index;
+			};
+
+			Handle addProblem(DataflowProblem problem);
+
+			// Solve both bundles on func, with the solver options of the opt command line
+			// (-dataflow-strategy, -dataflow-results, -dataflow-states).
+			void solve(Function& func);
+
+			// See FusedDataflow.
+			Optional<BitVector> stateAt(Handle problem, Instruction* I) const;
+			Optional<BitVector> boundaryState(Handle problem, BasicBlock* BB) const;
+			Optional<BitVector> inputState(Handle problem, BasicBlock* BB) const;
+
+			FusedDataflow<true>& getForward() { return forward_; }
+			FusedDataflow<false>& getBackward() { return backward_; }
+
+			// Counters of the last solve, summed over both bundles.
+			SolverStats getStats() const;
+
+		private:
+			FusedDataflow<true> forward_;
+			FusedDataflow<false> backward_;
+	};
+}
+
+#endif
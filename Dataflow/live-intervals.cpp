@@ -0,0 +1,162 @@
+// 15-745 Assignment 2: live-intervals.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <tuple>
+
+#include "live-intervals.h"
+#include "result-emitter.h"
+
+namespace llvm {
+	LivenessIntervals::LivenessIntervals(Function& F, const LivenessInfo& liveness) : F(F), liveness_(liveness) {
+		unsigned numVariables = liveness.getNumValues();
+		// (variable, start, end) of every run, as found block by block.
+		struct Run {
+			unsigned variable;
+			LiveSegment segment;
+		};
+		std::vector<Run> runs;
+		// End of the run of each variable live at the current point of the backward walk.
+		std::vector<unsigned> runEnd(numVariables);
+		unsigned first = 0;
+		for (BasicBlock& BB : F) {
+			unsigned end = first + BB.size();
+			unsigned n = first;
+			for (Instruction& I : BB) {
+				numbers_[&I] = n++;
+			}
+			Optional<BitVector> liveOut = liveness.getLiveOut(&BB);
+			if (!liveOut) {
+				first = end;
+				continue;
+			}
+			BitVector live = *liveOut;
+			for (unsigned v : live.set_bits()) {
+				runEnd[v] = end;
+			}
+			unsigned point = end;
+			BitVector before, changed;
+			for (auto it = BB.rbegin(); it != BB.rend(); ++it) {
+				--point;
+				before = live;
+				liveness.transfer(before, &*it);
+				// Live after the instruction only: the run starts right after it.
+				changed = live;
+				changed.reset(before);
+				for (unsigned v : changed.set_bits()) {
+					if (point + 1 < runEnd[v]) {
+						runs.push_back({v, {point + 1, runEnd[v]}});
+					}
+				}
+				// Live before the instruction only: a run ends right after it.
+				changed = before;
+				changed.reset(live);
+				for (unsigned v : changed.set_bits()) {
+					runEnd[v] = point + 1;
+				}
+				live = before;
+			}
+			for (unsigned v : live.set_bits()) {
+				runs.push_back({v, {first, runEnd[v]}});
+			}
+			first = end;
+		}
+
+		// Sort the runs by variable and start, then join overlapping and adjacent ones, e.g. the run at the
+		// end of a block and the run at the start of the next one.
+		std::sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) {
+			return std::tie(a.variable, a.segment.start) < std::tie(b.variable, b.segment.start);
+		});
+		segmentBegin_.assign(numVariables + 1, 0);
+		for (size_t r = 0; r < runs.size(); ++r) {
+			const Run& run = runs[r];
+			if (r > 0 && runs[r - 1].variable == run.variable && run.segment.start <= segments_.back().end) {
+				segments_.back().end = std::max(segments_.back().end, run.segment.end);
+				continue;
+			}
+			segments_.push_back(run.segment);
+			++segmentBegin_[run.variable + 1];
+		}
+		for (unsigned v = 0; v < numVariables; ++v) {
+			segmentBegin_[v + 1] += segmentBegin_[v];
+		}
+	}
+
+	unsigned LivenessIntervals::getNumber(const Instruction* I) const {
+		auto it = numbers_.find(I);
+		assert(it != numbers_.end() && "I is not an instruction of the function");
+		return it->second;
+	}
+
+	ArrayRef<LiveSegment> LivenessIntervals::getSegments(unsigned offset) const {
+		unsigned begin = segmentBegin_[offset];
+		return ArrayRef<LiveSegment>(segments_).slice(begin, segmentBegin_[offset + 1] - begin);
+	}
+
+	ArrayRef<LiveSegment> LivenessIntervals::getSegments(Value* v) const {
+		int offset = liveness_.getOffset(v);
+		return offset < 0 ? ArrayRef<LiveSegment>() : getSegments(offset);
+	}
+
+	// Some segment of segments holds point.
+	static bool covers(ArrayRef<LiveSegment> segments, unsigned point) {
+		auto it = std::upper_bound(segments.begin(), segments.end(), point,
+			[](unsigned p, const LiveSegment& segment) { return p < segment.end; });
+		return it != segments.end() && it->start <= point;
+	}
+
+	bool LivenessIntervals::isLiveAt(Value* v, const Instruction* I) const {
+		return covers(getSegments(v), getNumber(I));
+	}
+
+	BitVector LivenessIntervals::liveSetAt(const Instruction* I) const {
+		unsigned point = getNumber(I);
+		BitVector live(liveness_.getNumValues());
+		for (unsigned v = 0; v < live.size(); ++v) {
+			if (covers(getSegments(v), point)) {
+				live.set(v);
+			}
+		}
+		return live;
+	}
+
+	bool LivenessIntervals::interfere(Value* a, Value* b) const {
+		ArrayRef<LiveSegment> left = getSegments(a), right = getSegments(b);
+		size_t i = 0, j = 0;
+		while (i < left.size() && j < right.size()) {
+			if (left[i].end <= right[j].start) {
+				++i;
+			} else if (right[j].end <= left[i].start) {
+				++j;
+			} else {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	size_t LivenessIntervals::bytesAllocated() const {
+		return segments_.capacity() * sizeof(LiveSegment) + segmentBegin_.capacity() * sizeof(unsigned)
+			+ numbers_.getMemorySize();
+	}
+
+	void LivenessIntervals::print(raw_ostream& OS) const {
+		ValueNameTable names(F);
+		OS << "Live intervals of " << F.getName() << ": " << getNumInstructions() << " points, "
+			<< liveness_.getNumValues() << " variables, " << getNumSegments() << " segments, "
+			<< bytesAllocated() << " bytes\n";
+		for (unsigned v = 0; v < liveness_.getNumValues(); ++v) {
+			OS << names.get(liveness_.getValue(v)) << ":";
+			for (const LiveSegment& segment : getSegments(v)) {
+				OS << " [" << segment.start << ", " << segment.end << ")";
+			}
+			OS << "\n";
+		}
+	}
+
+	PreservedAnalyses LiveIntervalsPrinterPass::run(Function& F, FunctionAnalysisManager& FAM) {
+		LivenessIntervals(F, FAM.getResult<LivenessAnalysis>(F)).print(OS);
+		return PreservedAnalyses::all();
+	}
+}
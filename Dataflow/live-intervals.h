@@ -0,0 +1,84 @@
+// 15-745 Assignment 2: live-intervals.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __LIVE_INTERVALS_H__
+#define __LIVE_INTERVALS_H__
+
+#include <cstddef>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "liveness-support.h"
+
+namespace llvm {
+	// A run of consecutive program points [start, end) in the linear numbering of LivenessIntervals.
+	struct LiveSegment {
+		unsigned start;
+		unsigned end;
+	};
+
+	// Liveness results as live intervals, the shape a register allocator works on. The instructions of
+	// the function are numbered linearly in layout order, and number n stands for the point right before
+	// instruction n. The points where a variable is live are kept as sorted, disjoint and non-adjacent
+	// segments. Each SSA value is live over a few contiguous runs, so this takes memory proportional to
+	// the number of runs, not instructions × variables. The segments are built from the live-out set of
+	// every block, walking its instructions backwards with the transfer function. The liveness results
+	// must outlive the intervals.
+	class LivenessIntervals {
+		public:
+			LivenessIntervals(Function& F, const LivenessInfo& liveness);
+
+			// Number of I in the linear order.
+			unsigned getNumber(const Instruction* I) const;
+			unsigned getNumInstructions() const { return numbers_.size(); }
+			unsigned getNumSegments() const { return segments_.size(); }
+
+			// Segments of the variable at a bit offset of the liveness results, or of the variable of v
+			// (empty if v is not a variable).
+			ArrayRef<LiveSegment> getSegments(unsigned offset) const;
+			ArrayRef<LiveSegment> getSegments(Value* v) const;
+
+			// The variable of v is live right before I, the same as LivenessInfo::isLiveBefore(). A binary
+			// search in the segments of the variable.
+			bool isLiveAt(Value* v, const Instruction* I) const;
+			// All variables live right before I, the same as LivenessInfo::getLiveBefore() for reachable I.
+			// One binary search per variable.
+			BitVector liveSetAt(const Instruction* I) const;
+			// The variables of a and b are live at a common point. A merge of the two segment lists; a value
+			// defined at the last use of another does not interfere with it.
+			bool interfere(Value* a, Value* b) const;
+
+			// Bytes held by the segments and the instruction numbering.
+			size_t bytesAllocated() const;
+
+			// One line per variable with its segments: "%x: [3, 7) [10, 12)".
+			void print(raw_ostream& OS) const;
+
+		private:
+			Function& F;
+			const LivenessInfo& liveness_;
+			DenseMap<const Instruction*, unsigned> numbers_;
+			// Segments of variable v: segments_[segmentBegin_[v]] to segments_[segmentBegin_[v + 1]].
+			std::vector<unsigned> segmentBegin_;
+			std::vector<LiveSegment> segments_;
+	};
+
+	// opt -passes='print<live-intervals>': live intervals of the cached LivenessAnalysis result.
+	class LiveIntervalsPrinterPass : public PassInfoMixin<LiveIntervalsPrinterPass> {
+		public:
+			explicit LiveIntervalsPrinterPass(raw_ostream& OS) : OS(OS) {}
+			PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			raw_ostream& OS;
+	};
+}
+
+#endif
@@ -0,0 +1,321 @@
+// 15-745 Assignment 2: liveness-support.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+
+#include "liveness-support.h"
+#include "sparse-liveness.h"
+
+namespace llvm {
+	cl::opt<LivenessEngine> DataflowLivenessEngine(
+		"liveness-engine",
+		cl::desc("How liveness is computed"),
+		cl::init(LivenessEngine::Sparse),
+		cl::values(
+			clEnumValN(LivenessEngine::Sparse, "sparse",
+				"Walk def-use chains back from every use (default)"),
+			clEnumValN(LivenessEngine::Dense, "dense",
+				"Bitvector fixpoint with the dataflow solver (reference)")));
+
+	void LivenessPolicy::transfer(BitVector& in, Instruction* inst) const {
+		Instruction& instruction = *inst;
+
+		Var var(aliases.lookup(&instruction));
+		// If the current instruction in a variable, it will have an entry in the offset map.
+		// Place the variable in killset if it is defined.
+		auto offsetMapIter = offsetMap.find(var);
+		if(offsetMapIter != offsetMap.end()){
+			int offset = offsetMapIter->second;
+			in.reset(offset);
+		}
+
+		// Special processing for PHI node.
+		if(isa<PHINode>(&instruction)){
+			// Customized iteration over PHINode
+			PHINode* phi = dyn_cast<PHINode>(&instruction);
+			for(unsigned i = 0; i < phi->getNumIncomingValues(); i++){
+				use(in, phi->getIncomingValue(i));
+			}
+			return;
+		}
+
+		// A conditional branch requires the branching variable to be live.
+		BranchInst* br = dyn_cast<BranchInst>(&instruction);
+		if(br){
+			if (br->isConditional()) {
+				use(in, br->getCondition());
+			}
+		}
+
+		// Iterating over all operands; add uses to the set
+		for(auto oi = instruction.op_begin();oi!=instruction.op_end();++oi){
+			Value* val = *oi;
+			if(!val){
+				continue;
+			}
+			use(in, val);
+		}
+	}
+
+	void LivenessPolicy::genKill(Instruction* inst, BitVector& gen, BitVector& kill) const {
+		auto defined = offsetMap.find(Var(aliases.lookup(inst)));
+		if (defined != offsetMap.end()) {
+			kill.set(defined->second);
+		}
+		// PHI incoming values and branch conditions are operands too.
+		for (Value* val : inst->operand_values()) {
+			if (val) {
+				use(gen, val);
+			}
+		}
+	}
+
+	DataflowProblem makeLivenessProblem(LivenessPolicy policy) {
+		DataflowProblem problem;
+		problem.name = "liveness";
+		problem.forward = LivenessPolicy::forward;
+		problem.meet = DataflowProblem::Meet::Union;
+		problem.boundaryValue = LivenessPolicy::boundaryValue();
+		problem.numElements = policy.offsetMap.size();
+		problem.genKill = [policy](Instruction* I, BitVector& gen, BitVector& kill) {
+			policy.genKill(I, gen, kill);
+		};
+		return problem;
+	}
+
+	struct LivenessInfo::State {
+		State(Function& F, LivenessEngine engine);
+		~State();
+
+		const SolverStats& getStats() const {
+			return sparse ? sparse->getStats() : solver.getStats();
+		}
+		// Sparse engine: live set before I, replayed from the live-out set of its block. Const for the
+		// const queries of LivenessInfo, but it refills the block cache below, so it is not thread-safe.
+		Optional<BitVector> sparseLiveBefore(Instruction* I) const;
+
+		Function& F;
+		// Wall time of the phases run so far, reported by emitFunctionMetrics() when the state is released
+		PhaseTimes times;
+		// Alias sets of PHI-connected values, frozen into a member -> representative table
+		PhiAliasResolver aliases;
+		// Representative variable <-> bit offset
+		LivenessDataflow::BitVectorOffsetMap offsetMap;
+		LivenessDataflow::OffsetToElementMap offsetToElementMap;
+		// Dense engine
+		DataflowSolver<LivenessPolicy> solver;
+		// Sparse engine, plus the per-instruction states of the block last queried. Queries in program
+		// order replay each block once.
+		std::unique_ptr<SparseLiveness> sparse;
+		mutable BasicBlock* cachedBlock = nullptr;
+		mutable InstructionStateMap cachedStates;
+	};
+
+	// The solver options only apply to the dense engine. Warn once per process if one was given while
+	// liveness runs sparse; other analyses of the same run still honour it.
+	static void warnDenseOnlyOptions() {
+		static std::atomic<bool> warned(false);
+		if (!DataflowStrategy.getNumOccurrences() && !DataflowResultMode.getNumOccurrences() &&
+			!DataflowCheckpointInterval.getNumOccurrences() && !DataflowStates.getNumOccurrences()) {
+			return;
+		}
+		if (warned.exchange(true)) {
+			return;
+		}
+		errs() << "warning: -dataflow-strategy, -dataflow-results, -dataflow-checkpoint-interval and "
+			"-dataflow-states only apply to -liveness-engine=dense; the sparse liveness engine ignores them\n";
+	}
+
+	// All Elements to involve in the analysis: the representative of every instruction that defines a variable.
+	LivenessDataflow::BitVectorOffsetMap createLivenessOffsets(Function& F, const PhiAliasResolver& aliases) {
+		return LivenessDataflow::createBitVectorOffsetMap(F, [&aliases](Instruction* inst)->std::vector<Var>{
+			// return and branch are not variables, so they should not be involved.
+			if(isa<ReturnInst>(inst)||isa<BranchInst>(inst)){
+				return {};
+			}
+			return {Var(aliases.lookup(inst))};
+		});
+	}
+
+	LivenessInfo::State::State(Function& F, LivenessEngine engine)
+		: F(F),
+		aliases(timePhase(DataflowPhase::AliasResolution, times, [&] { return PhiAliasResolver(F); })),
+		offsetMap(timePhase(DataflowPhase::OffsetMap, times, [&] { return createLivenessOffsets(F, aliases); })),
+		solver(LivenessPolicy(aliases, offsetMap), offsetMap.size()) {
+		{
+			PhaseRegion region(DataflowPhase::OffsetMap, &times);
+			for(auto&[k,v]:offsetMap){
+				offsetToElementMap.insert({v,k});
+			}
+		}
+		PhaseRegion region(DataflowPhase::Solve, &times);
+		if (engine == LivenessEngine::Sparse) {
+			warnDenseOnlyOptions();
+			sparse = std::make_unique<SparseLiveness>(F, aliases, offsetMap);
+			return;
+		}
+		solver.setIterationStrategy(DataflowStrategy);
+		solver.setResultMode(DataflowResultMode, DataflowCheckpointInterval);
+		solver.setStateRepresentation(DataflowStates);
+		solver.solve(F);
+	}
+
+	LivenessInfo::State::~State() {
+		emitFunctionMetrics("liveness", F, getStats(), times);
+	}
+
+	Optional<BitVector> LivenessInfo::State::sparseLiveBefore(Instruction* I) const {
+		BasicBlock* BB = I->getParent();
+		if (!sparse->isReached(BB)) {
+			return None;
+		}
+		if (cachedBlock != BB) {
+			cachedBlock = BB;
+			cachedStates.clear();
+			BitVector state = sparse->liveOutBits(BB);
+			for (auto it = BB->rbegin(); it != BB->rend(); ++it) {
+				solver.getPolicy().transfer(state, &*it);
+				cachedStates[&*it] = state;
+			}
+		}
+		return cachedStates.lookup(I);
+	}
+
+	LivenessInfo::LivenessInfo(Function& F, LivenessEngine engine) : state_(std::make_unique<State>(F, engine)) {}
+	LivenessInfo::LivenessInfo(LivenessInfo&&) = default;
+	LivenessInfo& LivenessInfo::operator=(LivenessInfo&&) = default;
+	LivenessInfo::~LivenessInfo() = default;
+
+	unsigned LivenessInfo::getNumValues() const {
+		return state_->offsetMap.size();
+	}
+
+	Value* LivenessInfo::getValue(unsigned offset) const {
+		auto it = state_->offsetToElementMap.find(offset);
+		assert(it != state_->offsetToElementMap.end() && "offset out of range");
+		return it->second.v;
+	}
+
+	int LivenessInfo::getOffset(Value* v) const {
+		auto it = state_->offsetMap.find(Var(state_->aliases.lookup(v)));
+		return it == state_->offsetMap.end() ? -1 : it->second;
+	}
+
+	Optional<BitVector> LivenessInfo::getLiveBefore(Instruction* I) const {
+		if (state_->sparse) {
+			return state_->sparseLiveBefore(I);
+		}
+		return state_->solver.lookupState(I);
+	}
+
+	bool LivenessInfo::isLiveBefore(Value* v, Instruction* I) const {
+		int offset = getOffset(v);
+		if (offset < 0) {
+			return false;
+		}
+		Optional<BitVector> live = getLiveBefore(I);
+		return live && live->test(offset);
+	}
+
+	// Backward analysis: the boundary of a block is its IN set, the meet of its successors its OUT set.
+	Optional<BitVector> LivenessInfo::getLiveIn(BasicBlock* BB) const {
+		if (state_->sparse) {
+			if (!state_->sparse->isReached(BB)) {
+				return None;
+			}
+			return state_->sparse->liveInBits(BB);
+		}
+		const StateStore& states = state_->solver.getStates();
+		int block = states.blockIndex(BB);
+		if (block < 0) {
+			return None;
+		}
+		return states.boundaryState(block).toBitVector();
+	}
+
+	Optional<BitVector> LivenessInfo::getLiveOut(BasicBlock* BB) const {
+		if (state_->sparse) {
+			if (!state_->sparse->isReached(BB)) {
+				return None;
+			}
+			return state_->sparse->liveOutBits(BB);
+		}
+		const StateStore& states = state_->solver.getStates();
+		int block = states.blockIndex(BB);
+		if (block < 0) {
+			return None;
+		}
+		return states.inputState(block).toBitVector();
+	}
+
+	void LivenessInfo::transfer(BitVector& live, Instruction* I) const {
+		state_->solver.getPolicy().transfer(live, I);
+	}
+
+	const SolverStats& LivenessInfo::getStats() const {
+		return state_->getStats();
+	}
+
+	void LivenessInfo::print(raw_ostream& OS) const {
+		ResultEmitter emitter(OS, ResultFormat::Text);
+		emit(emitter);
+	}
+
+	void LivenessInfo::emit(ResultEmitter& emitter) const {
+		if (emitter.format() == ResultFormat::Silent) {
+			return;
+		}
+		PhaseRegion region(DataflowPhase::ResultEmission, &state_->times);
+		ValueNameTable names(state_->F);
+		std::vector<StringRef> elementNames(getNumValues());
+		for (auto& [offset, var] : state_->offsetToElementMap) {
+			elementNames[offset] = names.get(var.v);
+		}
+		if (!emitter.isText()) {
+			emitter.writeFunction("liveness", "before", state_->F, elementNames, getStats(),
+				[&](const Instruction& I) { return getLiveBefore(const_cast<Instruction*>(&I)); });
+			return;
+		}
+
+		raw_ostream& OS = emitter.text();
+		if (state_->sparse) {
+			state_->sparse->printStats(OS);
+		} else {
+			printSolverStats(getStats(), OS);
+		}
+
+		// Iterating over all instructions in the basic blocks, print the IN set of each instruction.
+		OS<<"-------Result Start----------\n";
+		OS<<"----Basic Block Boundary----\n";
+		for(auto& bb : state_->F){
+			for(auto& inst : bb){
+				Optional<BitVector> in = getLiveBefore(&inst);
+				if(in){
+					emitter.writeSet(*in, elementNames);
+				}
+				names.printInstruction(inst, OS);
+				OS<<"\n";
+			}
+			OS<<"----Basic Block Boundary----\n";
+		}
+	}
+
+	bool LivenessInfo::invalidate(Function& F, const PreservedAnalyses& PA,
+		FunctionAnalysisManager::Invalidator&) {
+		auto PAC = PA.getChecker<LivenessAnalysis>();
+		return !PAC.preserved() && !PAC.preservedSet<AllAnalysesOn<Function>>();
+	}
+
+	AnalysisKey LivenessAnalysis::Key;
+
+	LivenessInfo LivenessAnalysis::run(Function& F, FunctionAnalysisManager&) {
+		return LivenessInfo(F);
+	}
+
+	PreservedAnalyses LivenessPrinterPass::run(Function& F, FunctionAnalysisManager& FAM) {
+		ResultEmitter emitter(OS, DataflowOutput);
+		FAM.getResult<LivenessAnalysis>(F).emit(emitter);
+		return PreservedAnalyses::all();
+	}
+}
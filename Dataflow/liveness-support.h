@@ -0,0 +1,165 @@
+// 15-745 Assignment 2: liveness-support.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __LIVENESS_SUPPORT_H__
+#define __LIVENESS_SUPPORT_H__
+
+#include <memory>
+#include <string>
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "dataflow.h"
+#include "phi-alias.h"
+#include "result-emitter.h"
+
+namespace llvm {
+	// Simple struct to wrap Value* with customized print
+	struct Var{
+		Value* v;
+		Var():v(nullptr) {}
+		explicit Var(Value* v) : v(v) {}
+		explicit Var(Instruction* v) : v(static_cast<Value*>(v)) {}
+		std::string toString() const {
+			return getShortValueName(v);
+		}
+	};
+
+	template<> struct DenseMapInfo<Var> {
+	static inline Var getEmptyKey() {
+		return Var((Instruction*)-1); 
+	}
+	static inline Var getTombstoneKey() {
+		return Var((Instruction*)-2);
+	}
+	static unsigned getHashValue(const Var &var) {
+		return (uintptr_t)var.v;
+	}
+	static bool isEqual(const Var &LHS, const Var &RHS) {
+		return LHS.v == RHS.v;
+	}
+	};
+
+	using LivenessDataflow = DataflowAnalysis<Var, /** Forward = */ false>;
+
+	// How LivenessInfo computes liveness.
+	enum class LivenessEngine {
+		// Per variable, from its def-use chains (sparse-liveness.h). Only block live sets are stored.
+		Sparse,
+		// Bitvector fixpoint over the whole function with DataflowSolver and LivenessPolicy.
+		Dense
+	};
+
+	// Liveness engine selected on the opt command line (-liveness-engine).
+	extern cl::opt<LivenessEngine> DataflowLivenessEngine;
+
+	// Liveness as a solver policy: backward, union meet, nothing live at the exits.
+	// The transfer function updates the state in place and is inlined into the solver.
+	struct LivenessPolicy : UnionMeetPolicy {
+		static constexpr bool forward = false;
+		static constexpr TransferKind transferKind = TransferKind::Instruction;
+		static constexpr bool boundaryValue() { return false; }
+
+		LivenessPolicy(const PhiAliasResolver& aliases, const LivenessDataflow::BitVectorOffsetMap& offsetMap)
+			: aliases(aliases), offsetMap(offsetMap) {}
+
+		// Mark the representative of val live if it is a variable of the analysis.
+		void use(BitVector& in, Value* val) const {
+			auto usedIter = offsetMap.find(Var(aliases.lookup(val)));
+			if(usedIter != offsetMap.end()){
+				in.set(usedIter->second);
+			}
+		}
+
+		void transfer(BitVector& in, Instruction* inst) const;
+		// The same transfer as gen/kill sets: KILL is the variable inst defines, GEN the variables it uses.
+		void genKill(Instruction* inst, BitVector& gen, BitVector& kill) const;
+
+		const PhiAliasResolver& aliases;
+		const LivenessDataflow::BitVectorOffsetMap& offsetMap;
+	};
+
+	// Variables of the liveness analysis of F: the representative of every instruction that defines one.
+	LivenessDataflow::BitVectorOffsetMap createLivenessOffsets(Function& F, const PhiAliasResolver& aliases);
+
+	// Liveness as a backward problem of a fused bundle (fused-dataflow.h), using the gen/kill form of
+	// policy. The alias sets and the offset map of policy must outlive the problem.
+	DataflowProblem makeLivenessProblem(LivenessPolicy policy);
+
+	// Live variables of one function, solved once on construction and queried afterwards.
+	// Values are canonicalized through the PHI alias sets of the function. With the sparse engine the
+	// per-instruction queries fill a cache of the last block, so one LivenessInfo must not be queried
+	// from several threads at once.
+	class LivenessInfo {
+		public:
+			// Both engines give the same results; only the dense one honours the solver options
+			// (-dataflow-strategy, -dataflow-results, -dataflow-states), and the sparse one warns if
+			// they are given.
+			explicit LivenessInfo(Function& F, LivenessEngine engine = DataflowLivenessEngine);
+			LivenessInfo(LivenessInfo&&);
+			LivenessInfo& operator=(LivenessInfo&&);
+			~LivenessInfo();
+
+			// Number of variables, and the representative value at a bit offset of the states.
+			unsigned getNumValues() const;
+			Value* getValue(unsigned offset) const;
+			// Bit offset of the representative of v, or -1 if v is not a variable of the analysis.
+			int getOffset(Value* v) const;
+
+			// Variables live right before I, or None if I is unreachable.
+			Optional<BitVector> getLiveBefore(Instruction* I) const;
+			bool isLiveBefore(Value* v, Instruction* I) const;
+			// Variables live on entry to / on exit from BB, or None if BB is unreachable.
+			Optional<BitVector> getLiveIn(BasicBlock* BB) const;
+			Optional<BitVector> getLiveOut(BasicBlock* BB) const;
+			// Turn the variables live after I into the variables live before I, with the transfer function
+			// of the analysis.
+			void transfer(BitVector& live, Instruction* I) const;
+
+			const SolverStats& getStats() const;
+
+			// Print the solver counters and the live set before each instruction, in the format of the
+			// -liveness pass.
+			void print(raw_ostream& OS) const;
+			// Write the results in the format of emitter: print() for text, else one record of the live
+			// set before each instruction.
+			void emit(ResultEmitter& emitter) const;
+
+			// Results point into the IR, so they are dropped unless the analysis or all function analyses
+			// are preserved.
+			bool invalidate(Function& F, const PreservedAnalyses& PA, FunctionAnalysisManager::Invalidator&);
+
+		private:
+			// Kept behind a pointer: the solver policy refers to the other members, so they must not move.
+			struct State;
+			std::unique_ptr<State> state_;
+	};
+
+	// New pass manager analysis: opt -passes='require<liveness>' or any pass calling
+	// FAM.getResult<LivenessAnalysis>(F). The result is cached until invalidated.
+	class LivenessAnalysis : public AnalysisInfoMixin<LivenessAnalysis> {
+		public:
+			using Result = LivenessInfo;
+			Result run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			friend AnalysisInfoMixin<LivenessAnalysis>;
+			static AnalysisKey Key;
+	};
+
+	// opt -passes='print<liveness>': prints the cached LivenessAnalysis result.
+	class LivenessPrinterPass : public PassInfoMixin<LivenessPrinterPass> {
+		public:
+			explicit LivenessPrinterPass(raw_ostream& OS) : OS(OS) {}
+			PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			raw_ostream& OS;
+	};
+}
+
+#endif
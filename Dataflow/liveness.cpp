@@ -5,244 +5,178 @@
 #include <memory>
 #include <vector>
 
-#include "dataflow.h"
+#include "dead-code-elimination.h"
+#include "live-intervals.h"
+#include "liveness-support.h"
+#include "parallel-driver.h"
+#include "register-pressure.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
 #include "llvm/Pass.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
 
 using namespace llvm;
 
 namespace llvm {
-
-	
-
-	// Simple struct to wrap Value* with customized print
-	struct Var{
-		Value* v;
-		Var():v(nullptr) {}
-		explicit Var(Value* v) : v(v) {}
-		explicit Var(Instruction* v) : v(static_cast<Value*>(v)) {}
-		std::string toString() const {
-			return getShortValueName(v);
+	// Run liveness on F and write the live set before each instruction to OS, in the -dataflow-output
+	// format. Only reads the IR, so it can run on several functions concurrently.
+	static void runLiveness(Function& F, raw_ostream& OS) {
+		ResultEmitter emitter(OS, DataflowOutput);
+		if (emitter.isText()) {
+			emitter.text()<<"Running backward analysis\n";
 		}
+		LivenessInfo(F).emit(emitter);
+	}
 
-		
-		std::string getShortValueName(Value * v) const {
-			if (v->getName().str().length() > 0) {
-				return "%" + v->getName().str();
-			}
-			else if (isa<Instruction>(v)) {
-				std::string s = "";
-				raw_string_ostream * strm = new raw_string_ostream(s);
-				v->print(*strm);
-				std::string inst = strm->str();
-				size_t idx1 = inst.find("%");
-				size_t idx2 = inst.find(" ",idx1);
-				if (idx1 != std::string::npos && idx2 != std::string::npos) {
-					return inst.substr(idx1,idx2-idx1);
-				}
-				else {
-					return "\"" + inst + "\"";
+	// Run the pass with: 
+	// opt -enable-new-pm=0 -load ../Dataflow/liveness.so -liveness liveness-test-m2r.bc -o liveness.out
+	class Liveness : public FunctionPass {
+		public:
+			static char ID;
+
+			Liveness() : FunctionPass(ID) { 
+				if (DataflowOutput == ResultFormat::Text) {
+					outs()<<"Running liveness pass.";
+					outs().flush();
 				}
 			}
-			else if (Argument *arg = dyn_cast<Argument>(v)) {
-				std::string s = "";
-				raw_string_ostream * strm = new raw_string_ostream(s);
-				v->print(*strm);
-				std::string inst = strm->str();
-				size_t idx1 = inst.find("%");
-				if (idx1 != std::string::npos) {
-					return inst.substr(idx1);
-				}
-				else {
-					return "\"" + inst + "\"";
-				}
 
+			virtual bool runOnFunction(Function& F) override {
+				runLiveness(F, outs());
+
+				// Did not modify the incoming Function.
+				return false;
 			}
-			else {
-				std::string s = "";
-				raw_string_ostream * strm = new raw_string_ostream(s);
-				v->print(*strm);
-				std::string inst = strm->str();
-				return "\"" + inst + "\"";
-			}
-		}
 
-		
+			virtual void getAnalysisUsage(AnalysisUsage& AU) const override {
+				AU.setPreservesAll();
+			}
 
+		private:
 	};
 
-	template<> struct DenseMapInfo<Var> {
-	static inline Var getEmptyKey() {
-		return Var((Instruction*)-1); 
-	}
-	static inline Var getTombstoneKey() {
-		return Var((Instruction*)-2);
-	}
-	static unsigned getHashValue(const Var &var) {
-		return (uintptr_t)var.v;
-	}
-	static bool isEqual(const Var &LHS, const Var &RHS) {
-		return LHS.v == RHS.v;
-	}
-	};
+	// Module-level driver: analyzes all functions of the module concurrently (-dataflow-threads),
+	// largest first, and prints the results in the same order as the function pass.
+	class ParallelLiveness : public ModulePass {
+		public:
+			static char ID;
 
+			ParallelLiveness() : ModulePass(ID) { }
 
-	// Run the pass with: 
-	// opt -enable-new-pm=0 -load ../Dataflow/liveness.so -liveness liveness-test-m2r.bc -o liveness.out
-	class Liveness : public FunctionPass {
+			virtual bool runOnModule(Module& M) override {
+				runOnFunctionsInParallel(M, DataflowThreads, runLiveness, outs());
+				return false;
+			}
+
+			virtual void getAnalysisUsage(AnalysisUsage& AU) const override {
+				AU.setPreservesAll();
+			}
+	};
+
+	// Removes dead code with the liveness results and prints the counters of each function.
+	// opt -enable-new-pm=0 -load ../Dataflow/liveness.so -liveness-dce in.bc -o out.bc
+	class DeadCodeElimination : public FunctionPass {
 		public:
 			static char ID;
 
-			using LivenessAnalysis = DataflowAnalysis<Var, /** Forward = */ false>;
+			DeadCodeElimination() : FunctionPass(ID) { }
 
+			virtual bool runOnFunction(Function& F) override {
+				DeadCodeStats stats = eliminateDeadCode(F);
+				printDeadCodeStats(F, stats, outs());
+				return stats.instructions != 0;
+			}
 
-			Liveness() : FunctionPass(ID) { 
-				outs()<<"Running liveness pass.";
-				outs().flush();
+			virtual void getAnalysisUsage(AnalysisUsage& AU) const override {
+				AU.setPreservesCFG();
 			}
+	};
 
-			virtual bool runOnFunction(Function& F) override {
+	// Register pressure report of each function, from its liveness results.
+	// opt -enable-new-pm=0 -load ../Dataflow/liveness.so -pressure -pressure-limit=8 in.bc -o /dev/null
+	class RegisterPressure : public FunctionPass {
+		public:
+			static char ID;
 
-				DenseMap<Value*, Value*> aliasMap;
-
-				// A helper to find canonical representative
-				std::function<Value*(Value*)> findRepresentative = [&](Value *v) -> Value* {
-					while (aliasMap.count(v)) {
-						v = aliasMap[v];
-					}
-					return v;
-				};
-
-				// Build alias sets by scanning phi instructions
-				for (auto &B : F) {
-					for (auto &I : B) {
-						if (auto *phi = dyn_cast<PHINode>(&I)) {
-							Value *lhs = &I; // phi result
-							for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
-								Value *rhs = phi->getIncomingValue(i);
-								// Union: map rhs -> lhs
-								aliasMap[rhs] = lhs;
-							}
-						}
-					}
-				}
+			RegisterPressure() : FunctionPass(ID) { }
 
+			virtual bool runOnFunction(Function& F) override {
+				ResultEmitter emitter(outs(), DataflowOutput);
+				DominatorTree DT(F);
+				LoopInfo LI(DT);
+				RegisterPressureInfo(F, LivenessInfo(F), LI).emit(emitter);
+				return false;
+			}
 
-				// All Elements to involve in the analysis.
-				LivenessAnalysis::InstToElementFunc instToElementFunc = [&findRepresentative](Instruction* inst)->std::vector<Var>{
-					// return and branch are not variables, so they should not be involved.
-					if(isa<ReturnInst>(inst)||isa<BranchInst>(inst)){
-						return {};
-					}
-					return {Var(findRepresentative(inst))};
-				};
-
-				auto offsetMap = LivenessAnalysis::createBitVectorOffsetMap(F, instToElementFunc);
-				
-				LivenessAnalysis::OffsetToElementMap offsetToElementMap;
-				for(auto&[k,v]:offsetMap){
-					offsetToElementMap.insert({v,k});
-				}
+			virtual void getAnalysisUsage(AnalysisUsage& AU) const override {
+				AU.setPreservesAll();
+			}
+	};
 
-				LivenessAnalysis::TransferFunction transferFunction = [&findRepresentative,&offsetMap,&offsetToElementMap](const BitVector& out, Instruction* inst){
-					BitVector in = out;
-					Instruction& instruction = *inst;
-					
-					Var var(findRepresentative(&instruction));
-					// If the current instruction in a variable, it will have an entry in the offset map.
-					// Place the variable in killset if it is defined.
-					auto offsetMapIter = offsetMap.find(var);
-					if(offsetMapIter != offsetMap.end()){
-						int offset = offsetMapIter->second;
-						in.reset(offset);
-					}
-					
-					// Special processing for PHI node.
-					if(isa<PHINode>(&instruction)){
-						// Customized iteration over PHINode
-						PHINode* phi = dyn_cast<PHINode>(&instruction);
-						for(unsigned i = 0; i < phi->getNumIncomingValues(); i++){
-							Value* val = phi->getIncomingValue(i);
-							Var rhsVar(findRepresentative(val));
-							auto usedIter = offsetMap.find(rhsVar);
-							if(usedIter != offsetMap.end()){
-								int usedOffset = usedIter->second;
-								in.set(usedOffset);
-							}
-						}
-						printBitVector(in, offsetToElementMap);
-						return in;
-					}
-					
-					// A conditional branch requires the branching variable to be live.
-					BranchInst* br = dyn_cast<BranchInst>(&instruction);
-					if(br){
-						if (br->isConditional()) {
-							Value* condition = br->getCondition();  // Direct method
-							Var rhsVar(findRepresentative(condition));
-							auto usedIter = offsetMap.find(rhsVar);
-							if(usedIter != offsetMap.end()){
-								int usedOffset = usedIter->second;
-								in.set(usedOffset);
-							}
-						}
-					}
-
-					// Iterating over all operands; add uses to the set
-					for(auto oi = instruction.op_begin();oi!=instruction.op_end();++oi){
-						Value* val = *oi;
-						if(!val){
-							continue;
-						}
-						Var rhsVar(findRepresentative(val));
-
-						auto usedIter = offsetMap.find(rhsVar);
-						if(usedIter != offsetMap.end()){
-							int usedOffset = usedIter->second;
-							in.set(usedOffset);
-						}
-					}
-					printBitVector(in, offsetToElementMap);
-					return in;
-				};
-
-				LivenessAnalysis::MeetOperator setUnion = [](const BitVector& a, const BitVector& b) {
-					BitVector res = a;
-					res |= b;
-					return res;
-				};
-
-				LivenessAnalysis analysis(setUnion,transferFunction,offsetMap.size(),false,false);
-				std::pair<LivenessAnalysis::ResultMap,LivenessAnalysis::BlockResultMap> results = analysis.analyze(F, offsetToElementMap);
-				auto& instructionResults = results.first;
-				auto& blockResults = results.second;
-
-				// Iterating over all instructions in the basic blocks, fetch the IN set for each instruction.
-				outs()<<"-------Result Start----------\n";
-				outs()<<"----Basic Block Boundary----\n";
-				for(auto& bb : F){
-					
-					for(auto& inst : bb){
-						auto in = instructionResults.find(&inst);
-						if(in != instructionResults.end()){
-							printBitVector(in->second, offsetToElementMap);
-						}
-						outs()<<inst<<"\n";
-					}
-					//printBitVector(blockResults.lookup(&bb),offsetToElementMap);
-					outs()<<"----Basic Block Boundary----\n";
-				}
+	// Live intervals of each function, from its liveness results.
+	// opt -enable-new-pm=0 -load ../Dataflow/liveness.so -live-intervals in.bc -o /dev/null
+	class LiveIntervalPrinter : public FunctionPass {
+		public:
+			static char ID;
 
-				// Did not modify the incoming Function.
+			LiveIntervalPrinter() : FunctionPass(ID) { }
+
+			virtual bool runOnFunction(Function& F) override {
+				LivenessInfo liveness(F);
+				LivenessIntervals(F, liveness).print(outs());
 				return false;
 			}
 
 			virtual void getAnalysisUsage(AnalysisUsage& AU) const override {
 				AU.setPreservesAll();
 			}
-
-		private:
 	};
 
 	char Liveness::ID = 1;
 	static RegisterPass<Liveness> X("liveness", "15745 Liveness");
+
+	char ParallelLiveness::ID = 1;
+	static RegisterPass<ParallelLiveness> Y("liveness-parallel", "15745 Liveness (parallel module driver)");
+
+	char DeadCodeElimination::ID = 1;
+	static RegisterPass<DeadCodeElimination> Z("liveness-dce", "15745 Liveness Dead Code Elimination");
+
+	char RegisterPressure::ID = 1;
+	static RegisterPass<RegisterPressure> W("pressure", "15745 Register Pressure");
+
+	char LiveIntervalPrinter::ID = 1;
+	static RegisterPass<LiveIntervalPrinter> V("live-intervals", "15745 Live Intervals");
+}
+
+// New pass manager registration of the analysis, its printer and the passes built on it. Each plugin
+// registers only its own analysis, so liveness.so and available.so can be loaded together:
+// opt -load-pass-plugin ../Dataflow/liveness.so -passes='print<liveness>' liveness-test-m2r.bc -o /dev/null
+// liveness-dce is the dead code elimination, and print<register-pressure> and print<live-intervals> the
+// pressure report and the live intervals built on the liveness results.
+extern "C" PassPluginLibraryInfo llvmGetPassPluginInfo() {
+	return {LLVM_PLUGIN_API_VERSION, "Liveness", LLVM_VERSION_STRING, [](PassBuilder& PB) {
+		PB.registerAnalysisRegistrationCallback([](FunctionAnalysisManager& FAM) {
+			FAM.registerPass([] { return LivenessAnalysis(); });
+		});
+		PB.registerPipelineParsingCallback([](StringRef Name, FunctionPassManager& FPM,
+			ArrayRef<PassBuilder::PipelineElement>) {
+			if (Name == "print<liveness>") {
+				FPM.addPass(LivenessPrinterPass(outs()));
+			} else if (Name == "require<liveness>") {
+				FPM.addPass(RequireAnalysisPass<LivenessAnalysis, Function>());
+			} else if (Name == "invalidate<liveness>") {
+				FPM.addPass(InvalidateAnalysisPass<LivenessAnalysis>());
+			} else if (Name == "liveness-dce") {
+				FPM.addPass(DeadCodeEliminationPass(outs()));
+			} else if (Name == "print<register-pressure>") {
+				FPM.addPass(RegisterPressurePrinterPass(outs()));
+			} else if (Name == "print<live-intervals>") {
+				FPM.addPass(LiveIntervalsPrinterPass(outs()));
+			} else {
+				return false;
+			}
+			return true;
+		});
+	}};
 }
@@ -0,0 +1,127 @@
+// 15-745 Assignment 2: parallel-driver.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include "parallel-driver.h"
+#include "dataflow-metrics.h"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace llvm {
+	cl::opt<unsigned> DataflowThreads(
+		"dataflow-threads",
+		cl::desc("Worker threads of the parallel dataflow drivers (0 = one per hardware thread)"),
+		cl::init(0));
+
+	namespace {
+		// Deque of pending job indices owned by one worker.
+		struct WorkerQueue {
+			std::mutex lock;
+			std::deque<unsigned> jobs;
+
+			bool popFront(unsigned& job) {
+				std::lock_guard<std::mutex> guard(lock);
+				if (jobs.empty()) {
+					return false;
+				}
+				job = jobs.front();
+				jobs.pop_front();
+				return true;
+			}
+
+			bool stealBack(unsigned& job) {
+				std::lock_guard<std::mutex> guard(lock);
+				if (jobs.empty()) {
+					return false;
+				}
+				job = jobs.back();
+				jobs.pop_back();
+				return true;
+			}
+		};
+	}
+
+	WorkStealingPool::WorkStealingPool(unsigned numThreads) : numThreads_(numThreads) {
+		if (numThreads_ == 0) {
+			numThreads_ = std::max(1u, std::thread::hardware_concurrency());
+		}
+	}
+
+	void WorkStealingPool::run(ArrayRef<unsigned> order, function_ref<void(unsigned)> job) {
+		unsigned numWorkers = std::min<size_t>(numThreads_, order.size());
+		if (numWorkers <= 1) {
+			for (unsigned i : order) {
+				job(i);
+			}
+			return;
+		}
+		std::vector<std::unique_ptr<WorkerQueue>> queues;
+		for (unsigned w = 0; w < numWorkers; ++w) {
+			queues.push_back(std::make_unique<WorkerQueue>());
+		}
+		for (size_t i = 0; i < order.size(); ++i) {
+			queues[i % numWorkers]->jobs.push_back(order[i]);
+		}
+		// No job adds new jobs, so a worker that finds every deque empty can stop.
+		auto worker = [&](unsigned self) {
+			PhaseTimerSuspension noTimers;
+			unsigned next;
+			while (true) {
+				if (queues[self]->popFront(next)) {
+					job(next);
+					continue;
+				}
+				bool stolen = false;
+				for (unsigned v = 1; v < numWorkers && !stolen; ++v) {
+					stolen = queues[(self + v) % numWorkers]->stealBack(next);
+				}
+				if (!stolen) {
+					return;
+				}
+				job(next);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (unsigned w = 1; w < numWorkers; ++w) {
+			threads.emplace_back(worker, w);
+		}
+		worker(0);
+		for (std::thread& t : threads) {
+			t.join();
+		}
+	}
+
+	void runOnFunctionsInParallel(Module& M, unsigned numThreads,
+		function_ref<void(Function&, raw_ostream&)> analyzeFunction, raw_ostream& OS) {
+		std::vector<Function*> functions;
+		std::vector<size_t> sizes;
+		for (Function& F : M) {
+			if (F.isDeclaration()) continue;
+			functions.push_back(&F);
+			sizes.push_back(F.getInstructionCount());
+		}
+		// Largest functions first, so the longest jobs do not start last. Ties keep module order.
+		std::vector<unsigned> order(functions.size());
+		for (unsigned i = 0; i < order.size(); ++i) order[i] = i;
+		std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+			return sizes[a] > sizes[b];
+		});
+
+		std::vector<std::string> buffers(functions.size());
+		WorkStealingPool pool(numThreads);
+		pool.run(order, [&](unsigned i) {
+			raw_string_ostream stream(buffers[i]);
+			analyzeFunction(*functions[i], stream);
+			stream.flush();
+		});
+		for (const std::string& buffer : buffers) {
+			OS << buffer;
+		}
+	}
+}
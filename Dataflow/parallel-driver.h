@@ -0,0 +1,44 @@
+// 15-745 Assignment 2: parallel-driver.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PARALLEL_DRIVER_H__
+#define __PARALLEL_DRIVER_H__
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+namespace llvm {
+	// Number of worker threads of the module drivers (-dataflow-threads). 0 uses one per hardware thread.
+	extern cl::opt<unsigned> DataflowThreads;
+
+	// Runs a fixed batch of jobs on worker threads. Jobs are dealt round-robin, in the given order, onto
+	// per-worker deques. A worker takes jobs from the front of its own deque and, once that is empty,
+	// steals from the back of the other workers' deques.
+	class WorkStealingPool {
+		public:
+			// numThreads == 0 uses one worker per hardware thread.
+			explicit WorkStealingPool(unsigned numThreads);
+
+			unsigned numThreads() const { return numThreads_; }
+
+			// Call job(i) for every i in order and return when all calls have finished.
+			void run(ArrayRef<unsigned> order, function_ref<void(unsigned)> job);
+
+		private:
+			unsigned numThreads_;
+	};
+
+	// Analyze every function with a body in M on a WorkStealingPool, largest function first.
+	// analyzeFunction writes the output of one function to the stream it is given. Each function gets its
+	// own buffer, and the buffers are written to OS in module order, so the output is identical to running
+	// analyzeFunction on every function sequentially. analyzeFunction must only read the IR.
+	void runOnFunctionsInParallel(Module& M, unsigned numThreads,
+		function_ref<void(Function&, raw_ostream&)> analyzeFunction, raw_ostream& OS);
+}
+
+#endif
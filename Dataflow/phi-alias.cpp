@@ -0,0 +1,110 @@
+// 15-745 Assignment 2: phi-alias.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include "phi-alias.h"
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+
+namespace llvm {
+	PhiAliasResolver::PhiAliasResolver(Function& F) {
+		addPhis(F);
+		freeze();
+	}
+
+	void PhiAliasResolver::addPhis(Function& F) {
+		// Build alias sets by scanning phi instructions
+		for (auto &B : F) {
+			for (auto &I : B) {
+				if (auto *phi = dyn_cast<PHINode>(&I)) {
+					for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+						// Union: rhs joins the set of the phi result
+						unite(phi->getIncomingValue(i), phi);
+					}
+				}
+			}
+		}
+	}
+
+	unsigned PhiAliasResolver::idOf(Value* v) {
+		auto [it, inserted] = ids_.try_emplace(v, values_.size());
+		if (inserted) {
+			values_.push_back(v);
+			parent_.push_back(it->second);
+			rank_.push_back(0);
+			canonical_.push_back(v);
+		}
+		return it->second;
+	}
+
+	unsigned PhiAliasResolver::findRoot(unsigned id) {
+		unsigned root = id;
+		while (parent_[root] != root) {
+			root = parent_[root];
+		}
+		// Path compression: point every node on the way directly at the root.
+		while (parent_[id] != root) {
+			unsigned next = parent_[id];
+			parent_[id] = root;
+			id = next;
+		}
+		return root;
+	}
+
+	void PhiAliasResolver::unite(Value* member, Value* into) {
+		assert(!frozen_ && "cannot add aliases to a frozen resolver");
+		if (isa<Constant>(member)) {
+			constantAliases_[member] = into;
+			return;
+		}
+		unsigned a = findRoot(idOf(member));
+		unsigned b = findRoot(idOf(into));
+		if (a == b) {
+			return;
+		}
+		Value* canonical = canonical_[b];
+		// Union by rank: hang the shallower tree below the deeper one.
+		if (rank_[a] > rank_[b]) {
+			std::swap(a, b);
+		}
+		parent_[a] = b;
+		if (rank_[a] == rank_[b]) {
+			rank_[b]++;
+		}
+		canonical_[b] = canonical;
+	}
+
+	Value* PhiAliasResolver::find(Value* v) {
+		if (frozen_) {
+			return lookup(v);
+		}
+		auto constant = constantAliases_.find(v);
+		if (constant != constantAliases_.end()) {
+			v = constant->second;
+		}
+		auto it = ids_.find(v);
+		if (it == ids_.end()) {
+			return v;
+		}
+		return canonical_[findRoot(it->second)];
+	}
+
+	void PhiAliasResolver::freeze() {
+		representatives_.reserve(values_.size() + constantAliases_.size());
+		for (unsigned id = 0; id < values_.size(); ++id) {
+			representatives_[values_[id]] = canonical_[findRoot(id)];
+		}
+		for (auto& [constant, phi] : constantAliases_) {
+			representatives_[constant] = find(phi);
+		}
+		// Only the table is needed from now on.
+		ids_.clear();
+		constantAliases_.clear();
+		std::vector<Value*>().swap(values_);
+		std::vector<unsigned>().swap(parent_);
+		std::vector<unsigned>().swap(rank_);
+		std::vector<Value*>().swap(canonical_);
+		frozen_ = true;
+	}
+}
@@ -0,0 +1,78 @@
+// 15-745 Assignment 2: phi-alias.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PHI_ALIAS_H__
+#define __PHI_ALIAS_H__
+
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Value.h"
+
+namespace llvm {
+	// Alias sets of SSA values joined by PHI nodes: every incoming value of a PHI is unified with the PHI
+	// result, and each set is represented by the PHI result it was last merged into.
+	// Constants are shared by unrelated PHIs, so they never merge sets: a constant maps to the set of the
+	// last PHI it flows into.
+	// Sets are kept in a union-find forest with union by rank and path compression. After freeze(), the
+	// representative of every member is precomputed into one hash table from value to representative, and
+	// the forest is released. lookup() is then a single probe. It is not a flat array: LLVM values carry
+	// no dense index, so finding the slot of a value would take the same probe.
+	class PhiAliasResolver {
+		public:
+			PhiAliasResolver() = default;
+			// Unify the values of all PHI nodes in F and freeze the table.
+			explicit PhiAliasResolver(Function& F);
+
+			// Unify every incoming value of the PHI nodes in F with the PHI result.
+			void addPhis(Function& F);
+			// Merge the sets of member and into; the representative of into's set represents the result.
+			void unite(Value* member, Value* into);
+			// Representative of v, compressing the path to its root. Values in no set represent themselves.
+			// After freeze() this is lookup().
+			Value* find(Value* v);
+
+			// Precompute the representative of every value. unite() must not be called afterwards.
+			void freeze();
+			bool isFrozen() const { return frozen_; }
+			// Representative of v from the frozen table.
+			Value* lookup(Value* v) const {
+				assert(frozen_ && "lookup() needs a frozen resolver");
+				auto it = representatives_.find(v);
+				return it == representatives_.end() ? v : it->second;
+			}
+			Value* operator()(Value* v) const { return lookup(v); }
+
+			// Number of values that have a representative other than themselves or belong to a set.
+			unsigned size() const { return frozen_ ? representatives_.size() : ids_.size(); }
+
+			// Call f(v) for every value that belongs to a set, constants included, in no particular order.
+			template <class Callback>
+			void forEachMember(Callback&& f) const {
+				assert(frozen_ && "forEachMember() needs a frozen resolver");
+				for (auto& entry : representatives_) {
+					f(entry.first);
+				}
+			}
+
+		private:
+			unsigned idOf(Value* v);
+			unsigned findRoot(unsigned id);
+
+			DenseMap<Value*, unsigned> ids_;
+			std::vector<Value*> values_;
+			std::vector<unsigned> parent_;
+			std::vector<unsigned> rank_;
+			// Representative value of each root.
+			std::vector<Value*> canonical_;
+			// Constant incoming value -> the last PHI it flows into.
+			DenseMap<Value*, Value*> constantAliases_;
+			// Filled by freeze(): representative of every member, constants included.
+			DenseMap<Value*, Value*> representatives_;
+			bool frozen_ = false;
+	};
+}
+
+#endif
@@ -0,0 +1,216 @@
+// 15-745 Assignment 2: register-pressure.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <string>
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/Support/Format.h"
+
+#include "register-pressure.h"
+
+namespace llvm {
+	cl::opt<unsigned> PressureLimit(
+		"pressure-limit",
+		cl::desc("Live values of one register class above which a program point is flagged"),
+		cl::init(16));
+
+	// Flagged points listed by the text report; the JSON record only counts them.
+	static constexpr unsigned MaxReportedPoints = 5;
+
+	static const char* const RegisterClassNames[NumRegisterClasses] = {"int", "fp", "vec"};
+
+	RegisterClass getRegisterClass(Type* T) {
+		if (T->isVectorTy()) {
+			return RegisterClass::Vector;
+		}
+		if (T->isFloatingPointTy()) {
+			return RegisterClass::Float;
+		}
+		return RegisterClass::Integer;
+	}
+
+	void PressureSummary::addPoint(const unsigned (&pressure)[NumRegisterClasses]) {
+		++points;
+		for (unsigned c = 0; c < NumRegisterClasses; ++c) {
+			max[c] = std::max(max[c], pressure[c]);
+			total[c] += pressure[c];
+		}
+	}
+
+	void PressureSummary::add(const PressureSummary& other) {
+		points += other.points;
+		for (unsigned c = 0; c < NumRegisterClasses; ++c) {
+			max[c] = std::max(max[c], other.max[c]);
+			total[c] += other.total[c];
+		}
+	}
+
+	RegisterPressureInfo::RegisterPressureInfo(Function& F, const LivenessInfo& liveness, LoopInfo& LI, unsigned limit)
+		: F(F), limit_(limit) {
+		std::vector<RegisterClass> classOf(liveness.getNumValues());
+		for (unsigned offset = 0; offset < classOf.size(); ++offset) {
+			classOf[offset] = getRegisterClass(liveness.getValue(offset)->getType());
+		}
+		for (BasicBlock& BB : F) {
+			if (!liveness.getLiveIn(&BB)) {
+				continue;
+			}
+			PressureSummary& block = blocks_[&BB];
+			for (Instruction& I : BB) {
+				Optional<BitVector> live = liveness.getLiveBefore(&I);
+				unsigned pressure[NumRegisterClasses] = {};
+				for (unsigned offset : live->set_bits()) {
+					++pressure[(unsigned)classOf[offset]];
+				}
+				block.addPoint(pressure);
+				if (*std::max_element(pressure, pressure + NumRegisterClasses) > limit_) {
+					HotPoint point{&I, {}};
+					std::copy(pressure, pressure + NumRegisterClasses, point.pressure);
+					hotPoints_.push_back(point);
+				}
+			}
+			function_.add(block);
+		}
+
+		for (Loop* L : LI.getLoopsInPreorder()) {
+			LoopPressure loop{L->getHeader(), L->getLoopDepth(), L->getNumBlocks(), PressureSummary()};
+			for (BasicBlock* BB : L->blocks()) {
+				if (const PressureSummary* block = getBlockSummary(BB)) {
+					loop.summary.add(*block);
+				}
+			}
+			loops_.push_back(loop);
+		}
+	}
+
+	const PressureSummary* RegisterPressureInfo::getBlockSummary(BasicBlock* BB) const {
+		auto it = blocks_.find(BB);
+		return it == blocks_.end() ? nullptr : &it->second;
+	}
+
+	// "int max 12 avg 4.31, fp max 0 avg 0.00, vec max 0 avg 0.00"
+	static void printSummary(const PressureSummary& summary, raw_ostream& OS) {
+		for (unsigned c = 0; c < NumRegisterClasses; ++c) {
+			OS << (c ? ", " : "") << RegisterClassNames[c] << " max " << summary.max[c] << " avg "
+				<< format("%.2f", summary.average(c));
+		}
+	}
+
+	void RegisterPressureInfo::print(raw_ostream& OS) const {
+		ValueNameTable names(F);
+		OS << "Register pressure of " << F.getName() << " (" << function_.points << " points): ";
+		printSummary(function_, OS);
+		OS << "; " << hotPoints_.size() << " points over " << limit_ << "\n";
+		for (const LoopPressure& loop : loops_) {
+			OS << "  loop " << names.get(loop.header) << " (depth " << loop.depth << ", " << loop.numBlocks
+				<< " blocks): ";
+			printSummary(loop.summary, OS);
+			OS << "\n";
+		}
+		const BasicBlock* last = nullptr;
+		for (const HotPoint& point : hotPoints_) {
+			const BasicBlock* BB = point.I->getParent();
+			if (BB == last) {
+				continue;
+			}
+			last = BB;
+			OS << "  block " << names.get(const_cast<BasicBlock*>(BB)) << ": ";
+			printSummary(blocks_.find(BB)->second, OS);
+			OS << "\n";
+		}
+		// The worst points first, by their largest class; ties stay in function order.
+		std::vector<const HotPoint*> worst;
+		for (const HotPoint& point : hotPoints_) {
+			worst.push_back(&point);
+		}
+		auto peak = [](const HotPoint* point) {
+			return *std::max_element(point->pressure, point->pressure + NumRegisterClasses);
+		};
+		std::stable_sort(worst.begin(), worst.end(),
+			[&](const HotPoint* a, const HotPoint* b) { return peak(a) > peak(b); });
+		worst.resize(std::min<size_t>(worst.size(), MaxReportedPoints));
+		for (const HotPoint* point : worst) {
+			OS << "  over " << limit_ << " (";
+			for (unsigned c = 0; c < NumRegisterClasses; ++c) {
+				OS << (c ? " " : "") << RegisterClassNames[c] << " " << point->pressure[c];
+			}
+			std::string instruction;
+			raw_string_ostream strm(instruction);
+			names.printInstruction(*point->I, strm);
+			OS << ") before " << StringRef(strm.str()).ltrim() << "\n";
+		}
+	}
+
+	void RegisterPressureInfo::printJSON(raw_ostream& OS) const {
+		ValueNameTable names(F);
+		auto quoted = [&](StringRef s) {
+			OS << "\"";
+			OS.write_escaped(s);
+			OS << "\"";
+		};
+		auto summary = [&](const PressureSummary& s) {
+			OS << "\"points\":" << s.points << ",\"max\":[";
+			for (unsigned c = 0; c < NumRegisterClasses; ++c) {
+				OS << (c ? "," : "") << s.max[c];
+			}
+			OS << "],\"avg\":[";
+			for (unsigned c = 0; c < NumRegisterClasses; ++c) {
+				OS << (c ? "," : "") << format("%.2f", s.average(c));
+			}
+			OS << "]";
+		};
+		OS << "{\"analysis\":\"pressure\",\"function\":";
+		quoted(F.getName());
+		OS << ",\"limit\":" << limit_ << ",\"overLimit\":" << hotPoints_.size() << ",";
+		summary(function_);
+		OS << ",\"loops\":[";
+		for (size_t i = 0; i < loops_.size(); ++i) {
+			OS << (i ? "," : "") << "{\"header\":";
+			quoted(names.get(loops_[i].header));
+			OS << ",\"depth\":" << loops_[i].depth << ",\"blocks\":" << loops_[i].numBlocks << ",";
+			summary(loops_[i].summary);
+			OS << "}";
+		}
+		OS << "],\"blocks\":[";
+		bool first = true;
+		for (BasicBlock& BB : F) {
+			const PressureSummary* block = getBlockSummary(&BB);
+			if (!block) {
+				continue;
+			}
+			OS << (first ? "" : ",") << "{\"block\":";
+			first = false;
+			quoted(names.get(&BB));
+			OS << ",";
+			summary(*block);
+			OS << "}";
+		}
+		OS << "]}\n";
+	}
+
+	void RegisterPressureInfo::emit(ResultEmitter& emitter) const {
+		// Binary records hold per-instruction states, which the report does not have.
+		if (emitter.format() == ResultFormat::Binary) {
+			F.getContext().emitError("the register pressure report does not support -dataflow-output=binary; "
+				"use text or jsonl");
+			return;
+		}
+		if (emitter.format() == ResultFormat::Silent) {
+			return;
+		}
+		if (emitter.isText()) {
+			print(emitter.text());
+		} else {
+			printJSON(emitter.text());
+		}
+	}
+
+	PreservedAnalyses RegisterPressurePrinterPass::run(Function& F, FunctionAnalysisManager& FAM) {
+		ResultEmitter emitter(OS, DataflowOutput);
+		RegisterPressureInfo(F, FAM.getResult<LivenessAnalysis>(F), FAM.getResult<LoopAnalysis>(F)).emit(emitter);
+		return PreservedAnalyses::all();
+	}
+}
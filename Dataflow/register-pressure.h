@@ -0,0 +1,107 @@
+// 15-745 Assignment 2: register-pressure.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __REGISTER_PRESSURE_H__
+#define __REGISTER_PRESSURE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "liveness-support.h"
+#include "result-emitter.h"
+
+namespace llvm {
+	class LoopInfo;
+
+	// Register file a value of the analysis would be allocated to.
+	enum class RegisterClass { Integer, Float, Vector };
+	constexpr unsigned NumRegisterClasses = 3;
+
+	// Vector types go to vector registers, floating point scalars to floating point registers and
+	// everything else (integers, pointers, aggregates) to integer registers.
+	RegisterClass getRegisterClass(Type* T);
+
+	// Live values per register class above which a program point is flagged (-pressure-limit).
+	extern cl::opt<unsigned> PressureLimit;
+
+	// Live-set sizes of the program points of a region, per register class.
+	struct PressureSummary {
+		unsigned points = 0;
+		unsigned max[NumRegisterClasses] = {};
+		uint64_t total[NumRegisterClasses] = {};
+
+		void addPoint(const unsigned (&pressure)[NumRegisterClasses]);
+		void add(const PressureSummary& other);
+		double average(unsigned c) const { return points == 0 ? 0 : (double)total[c] / points; }
+	};
+
+	// Register pressure of one function from its liveness results. A program point is the point right
+	// before an instruction, and its pressure is the number of live variables of each register class.
+	// A variable is a PHI alias set, classified by the type of its representative. The loops of LI get a
+	// summary each.
+	class RegisterPressureInfo {
+		public:
+			// Pressure of a loop: all points of its blocks, inner loops included.
+			struct LoopPressure {
+				BasicBlock* header;
+				unsigned depth;
+				unsigned numBlocks;
+				PressureSummary summary;
+			};
+			// A program point where some register class has more than limit live values.
+			struct HotPoint {
+				Instruction* I;
+				unsigned pressure[NumRegisterClasses];
+			};
+
+			RegisterPressureInfo(Function& F, const LivenessInfo& liveness, LoopInfo& LI, unsigned limit = PressureLimit);
+
+			unsigned getLimit() const { return limit_; }
+			const PressureSummary& getFunctionSummary() const { return function_; }
+			// Summary of BB, or null if BB is unreachable.
+			const PressureSummary* getBlockSummary(BasicBlock* BB) const;
+			// Loops in preorder: every loop before the loops nested in it.
+			ArrayRef<LoopPressure> getLoops() const { return loops_; }
+			// Flagged points in function order.
+			ArrayRef<HotPoint> getHotPoints() const { return hotPoints_; }
+
+			// Compact text report: one line for the function, one per loop, one per block with a flagged
+			// point and the worst flagged points.
+			void print(raw_ostream& OS) const;
+			// One JSON record with the summaries of the function, its loops and its blocks, and the number of
+			// flagged points.
+			void printJSON(raw_ostream& OS) const;
+			// print() for text, printJSON() for jsonl, nothing for silent. Binary is rejected through
+			// LLVMContext::emitError(), which stops opt with an error.
+			void emit(ResultEmitter& emitter) const;
+
+		private:
+			Function& F;
+			unsigned limit_;
+			PressureSummary function_;
+			DenseMap<const BasicBlock*, PressureSummary> blocks_;
+			std::vector<LoopPressure> loops_;
+			std::vector<HotPoint> hotPoints_;
+	};
+
+	// opt -passes='print<register-pressure>': pressure report of the cached LivenessAnalysis and LoopAnalysis
+	// results.
+	class RegisterPressurePrinterPass : public PassInfoMixin<RegisterPressurePrinterPass> {
+		public:
+			explicit RegisterPressurePrinterPass(raw_ostream& OS) : OS(OS) {}
+			PreservedAnalyses run(Function& F, FunctionAnalysisManager& FAM);
+
+		private:
+			raw_ostream& OS;
+	};
+}
+
+#endif
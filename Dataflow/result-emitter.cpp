@@ -0,0 +1,219 @@
+// 15-745 Assignment 2: result-emitter.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/EndianStream.h"
+
+#include "result-emitter.h"
+
+namespace llvm {
+	cl::opt<ResultFormat> DataflowOutput(
+		"dataflow-output",
+		cl::desc("Output format of the dataflow passes"),
+		cl::init(ResultFormat::Text),
+		cl::values(
+			clEnumValN(ResultFormat::Text, "text", "Sets next to the printed IR (default)"),
+			clEnumValN(ResultFormat::JSONLines, "jsonl", "One JSON record per function"),
+			clEnumValN(ResultFormat::Binary, "binary", "One binary record per function"),
+			clEnumValN(ResultFormat::Silent, "silent", "No output")));
+
+	// Flush the buffer to the destination once it holds this many bytes.
+	static const size_t FlushThreshold = 1 << 16;
+
+	// Print v into a string, the slow path of getShortValueName().
+	static std::string printValue(Value* v, ModuleSlotTracker* MST) {
+		std::string inst;
+		raw_string_ostream strm(inst);
+		if (MST) {
+			v->print(strm, *MST);
+		} else {
+			v->print(strm);
+		}
+		strm.flush();
+		return inst;
+	}
+
+	// The name is sliced out of the printed IR: there is no "get the variable on the left hand side"
+	// function in LLVM, and unnamed values only get their '%0' or '%1' when printed. Non-void values and
+	// blocks are printed as an operand, which is the same slice. ConstantInts are the only pretty printed
+	// Constants.
+	std::string getShortValueName(Value* v, ModuleSlotTracker* MST) {
+		if (v->hasName()) {
+			return "%" + v->getName().str();
+		}
+		if (ConstantInt* cint = dyn_cast<ConstantInt>(v)) {
+			std::string s;
+			raw_string_ostream strm(s);
+			cint->getValue().print(strm, true);
+			return strm.str();
+		}
+		if (MST && (isa<Argument>(v) || isa<BasicBlock>(v) || (isa<Instruction>(v) && !v->getType()->isVoidTy()))) {
+			std::string name;
+			raw_string_ostream strm(name);
+			v->printAsOperand(strm, false, *MST);
+			return strm.str();
+		}
+		std::string inst = printValue(v, MST);
+		size_t idx1 = inst.find("%");
+		if (isa<Instruction>(v)) {
+			size_t idx2 = inst.find(" ", idx1);
+			if (idx1 != std::string::npos && idx2 != std::string::npos) {
+				return inst.substr(idx1, idx2 - idx1);
+			}
+		} else if (isa<Argument>(v) && idx1 != std::string::npos) {
+			return inst.substr(idx1);
+		}
+		return "\"" + inst + "\"";
+	}
+
+	ValueNameTable::ValueNameTable(const Function& F) : MST_(F.getParent()), saver_(allocator_) {
+		MST_.incorporateFunction(F);
+	}
+
+	StringRef ValueNameTable::get(Value* v) {
+		auto [it, inserted] = names_.try_emplace(v);
+		if (inserted) {
+			it->second = saver_.save(getShortValueName(v, &MST_));
+		}
+		return it->second;
+	}
+
+	void ValueNameTable::printInstruction(const Instruction& I, raw_ostream& OS) {
+		I.print(OS, MST_);
+	}
+
+	ResultEmitter::ResultEmitter(raw_ostream& OS, ResultFormat format)
+		: OS_(OS), format_(format), buffer_(storage_) {
+		storage_.reserve(FlushThreshold);
+	}
+
+	ResultEmitter::~ResultEmitter() {
+		buffer_.flush();
+		OS_ << storage_;
+	}
+
+	void ResultEmitter::flushIfFull() {
+		buffer_.flush();
+		if (storage_.size() >= FlushThreshold) {
+			OS_ << storage_;
+			storage_.clear();
+		}
+	}
+
+	void ResultEmitter::writeSet(const BitVector& state, ArrayRef<StringRef> elementNames) {
+		buffer_ << "{";
+		bool first = true;
+		for (unsigned i : state.set_bits()) {
+			if (!first) buffer_ << ", ";
+			buffer_ << elementNames[i];
+			first = false;
+		}
+		buffer_ << "}\n";
+		flushIfFull();
+	}
+
+	// JSON record:
+	//   {"analysis":..,"function":..,"point":"before"|"after","iterations":..,"blockVisits":..,
+	//    "elements":["name",...],"states":[[offset,...] or null per instruction]}
+	// Binary record, little endian, strings as u32 length + bytes:
+	//   "DFR1", analysis, function, point, u32 iterations, u32 blockVisits,
+	//   u32 #elements, element names, u32 words per state, u32 #instructions,
+	//   u32 payload row per instruction (0xffffffff if unreached), u32 #rows, rows of u64 words.
+	// Consecutive instructions with the same state share a payload row.
+	void ResultEmitter::writeFunction(StringRef analysis, StringRef point, const Function& F,
+		ArrayRef<StringRef> elementNames, const SolverStats& stats,
+		function_ref<Optional<BitVector>(const Instruction&)> stateOf) {
+		if (format_ == ResultFormat::JSONLines) {
+			auto quoted = [&](StringRef s) {
+				buffer_ << "\"";
+				buffer_.write_escaped(s);
+				buffer_ << "\"";
+			};
+			buffer_ << "{\"analysis\":";
+			quoted(analysis);
+			buffer_ << ",\"function\":";
+			quoted(F.getName());
+			buffer_ << ",\"point\":";
+			quoted(point);
+			buffer_ << ",\"iterations\":" << stats.changedBoundaries << ",\"blockVisits\":" << stats.blockVisits
+				<< ",\"elements\":[";
+			for (size_t i = 0; i < elementNames.size(); ++i) {
+				if (i) buffer_ << ",";
+				quoted(elementNames[i]);
+			}
+			buffer_ << "],\"states\":[";
+			bool firstInst = true;
+			for (const BasicBlock& BB : F) {
+				for (const Instruction& I : BB) {
+					if (!firstInst) buffer_ << ",";
+					firstInst = false;
+					Optional<BitVector> state = stateOf(I);
+					if (!state) {
+						buffer_ << "null";
+						continue;
+					}
+					buffer_ << "[";
+					bool first = true;
+					for (unsigned i : state->set_bits()) {
+						if (!first) buffer_ << ",";
+						buffer_ << i;
+						first = false;
+					}
+					buffer_ << "]";
+				}
+				flushIfFull();
+			}
+			buffer_ << "]}\n";
+		} else if (format_ == ResultFormat::Binary) {
+			support::endian::Writer out(buffer_, support::little);
+			auto string = [&](StringRef s) {
+				out.write<uint32_t>(s.size());
+				buffer_ << s;
+			};
+			buffer_ << "DFR1";
+			string(analysis);
+			string(F.getName());
+			string(point);
+			out.write<uint32_t>(stats.changedBoundaries);
+			out.write<uint32_t>(stats.blockVisits);
+			out.write<uint32_t>(elementNames.size());
+			for (StringRef name : elementNames) {
+				string(name);
+			}
+			// The payload words are 64 bits wide whatever the width of the host BitVector words.
+			unsigned numWords = (elementNames.size() + 63) / 64;
+			out.write<uint32_t>(numWords);
+			out.write<uint32_t>(F.getInstructionCount());
+			std::vector<BitVector> rows;
+			for (const BasicBlock& BB : F) {
+				for (const Instruction& I : BB) {
+					Optional<BitVector> state = stateOf(I);
+					if (!state) {
+						out.write<uint32_t>(~0u);
+						continue;
+					}
+					if (rows.empty() || rows.back() != *state) {
+						rows.push_back(std::move(*state));
+					}
+					out.write<uint32_t>(rows.size() - 1);
+				}
+			}
+			out.write<uint32_t>(rows.size());
+			std::vector<uint64_t> words(numWords);
+			for (const BitVector& row : rows) {
+				std::fill(words.begin(), words.end(), 0);
+				for (unsigned bit : row.set_bits()) {
+					words[bit / 64] |= uint64_t(1) << (bit % 64);
+				}
+				for (uint64_t word : words) {
+					out.write<uint64_t>(word);
+				}
+			}
+		}
+		flushIfFull();
+	}
+}
@@ -0,0 +1,98 @@
+// 15-745 Assignment 2: result-emitter.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __RESULT_EMITTER_H__
+#define __RESULT_EMITTER_H__
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Optional.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "dataflow-metrics.h"
+
+namespace llvm {
+	// Output formats of the dataflow passes.
+	enum class ResultFormat {
+		// Human-readable sets next to the printed IR (default).
+		Text,
+		// One JSON record per function.
+		JSONLines,
+		// One binary record per function: an offset table into a payload of deduplicated state rows.
+		Binary,
+		// Nothing at all.
+		Silent
+	};
+
+	// Output format selected on the opt command line (-dataflow-output).
+	extern cl::opt<ResultFormat> DataflowOutput;
+
+	// Short name of v as the passes print it: "%name", "%5" for unnamed values, the integer for constant
+	// ints and the quoted IR otherwise. With a slot tracker incorporating v's function, unnamed values are
+	// numbered without printing their whole instruction.
+	std::string getShortValueName(Value* v, ModuleSlotTracker* MST = nullptr);
+
+	// Display names of the values of one function, each computed once, and IR printing with one shared
+	// slot numbering instead of renumbering the function for every printed instruction.
+	class ValueNameTable {
+		public:
+			explicit ValueNameTable(const Function& F);
+
+			// getShortValueName(v), interned. The string lives as long as the table.
+			StringRef get(Value* v);
+			// Same as OS << I.
+			void printInstruction(const Instruction& I, raw_ostream& OS);
+
+		private:
+			ModuleSlotTracker MST_;
+			BumpPtrAllocator allocator_;
+			StringSaver saver_;
+			DenseMap<Value*, StringRef> names_;
+	};
+
+	// Buffered writer of the results of one analysis run. Text is formatted by the analysis itself through
+	// text(); the machine-readable formats are produced by writeFunction(). Output is flushed to the
+	// destination stream in large chunks and when the emitter is destroyed.
+	class ResultEmitter {
+		public:
+			ResultEmitter(raw_ostream& OS, ResultFormat format);
+			~ResultEmitter();
+
+			ResultFormat format() const { return format_; }
+			bool isText() const { return format_ == ResultFormat::Text; }
+
+			// Buffered stream for text output.
+			raw_ostream& text() { return buffer_; }
+			// Write "{name, name, ...}\n" for the set bits of state.
+			void writeSet(const BitVector& state, ArrayRef<StringRef> elementNames);
+
+			// Write the record of one function: its element names, solver counters and the state of every
+			// instruction in function order, as returned by stateOf (None for unreached instructions).
+			// point names the program point of the states ("before" or "after" the instruction).
+			void writeFunction(StringRef analysis, StringRef point, const Function& F,
+				ArrayRef<StringRef> elementNames, const SolverStats& stats,
+				function_ref<Optional<BitVector>(const Instruction&)> stateOf);
+
+		private:
+			void flushIfFull();
+
+			raw_ostream& OS_;
+			ResultFormat format_;
+			std::string storage_;
+			raw_string_ostream buffer_;
+	};
+}
+
+#endif
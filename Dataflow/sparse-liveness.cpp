@@ -0,0 +1,197 @@
+// 15-745 Assignment 2: sparse-liveness.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+
+#include "sparse-liveness.h"
+
+namespace llvm {
+	SparseLiveness::SparseLiveness(Function& F, const PhiAliasResolver& aliases,
+		const LivenessDataflow::BitVectorOffsetMap& offsetMap) : numVars_(offsetMap.size()) {
+		auto varOf = [&](Value* v) {
+			auto it = offsetMap.find(Var(aliases.lookup(v)));
+			return it == offsetMap.end() ? -1 : it->second;
+		};
+
+		// Number the reached blocks and their instructions.
+		DenseMap<const Instruction*, unsigned> instIndex;
+		blockBegin_.push_back(0);
+		for (BasicBlock* BB : depth_first(&F.getEntryBlock())) {
+			blockIndex_[BB] = blocks_.size();
+			blocks_.push_back(BB);
+			for (Instruction& I : *BB) {
+				instIndex[&I] = defs_.size();
+				defs_.push_back(varOf(&I));
+			}
+			blockBegin_.push_back(defs_.size());
+		}
+		blockDefsBegin_.push_back(0);
+		predBegin_.push_back(0);
+		for (unsigned b = 0; b < blocks_.size(); ++b) {
+			size_t begin = blockDefs_.size();
+			for (unsigned i = blockBegin_[b]; i < blockBegin_[b + 1]; ++i) {
+				if (defs_[i] >= 0) {
+					blockDefs_.push_back(defs_[i]);
+				}
+			}
+			std::sort(blockDefs_.begin() + begin, blockDefs_.end());
+			blockDefs_.erase(std::unique(blockDefs_.begin() + begin, blockDefs_.end()), blockDefs_.end());
+			blockDefsBegin_.push_back(blockDefs_.size());
+			for (const BasicBlock* pred : predecessors(blocks_[b])) {
+				auto it = blockIndex_.find(pred);
+				if (it != blockIndex_.end()) {
+					preds_.push_back(it->second);
+				}
+			}
+			predBegin_.push_back(preds_.size());
+		}
+
+		// Use sites (variable, instruction index), from the def-use chains of every value that belongs to
+		// a variable. Constants are uniqued across the module, so their few aliased uses are found by a
+		// scan of the operands instead of their module-wide use lists.
+		std::vector<std::pair<int, unsigned>> uses;
+		auto addUsers = [&](Value* v, int var) {
+			for (User* user : v->users()) {
+				auto it = instIndex.find(dyn_cast<Instruction>(user));
+				if (it != instIndex.end()) {
+					uses.push_back({var, it->second});
+				}
+			}
+		};
+		for (Argument& arg : F.args()) {
+			int var = varOf(&arg);
+			if (var >= 0) {
+				addUsers(&arg, var);
+			}
+		}
+		for (BasicBlock& BB : F) {
+			for (Instruction& I : BB) {
+				int var = varOf(&I);
+				if (var >= 0) {
+					addUsers(&I, var);
+				}
+			}
+		}
+		DenseMap<Value*, int> constants;
+		aliases.forEachMember([&](Value* v) {
+			int var = isa<Constant>(v) ? varOf(v) : -1;
+			if (var >= 0) {
+				constants[v] = var;
+			}
+		});
+		if (!constants.empty()) {
+			for (const BasicBlock* BB : blocks_) {
+				for (const Instruction& I : *BB) {
+					for (Value* op : I.operands()) {
+						auto it = isa<Constant>(op) ? constants.find(op) : constants.end();
+						if (it != constants.end()) {
+							uses.push_back({it->second, instIndex[&I]});
+						}
+					}
+				}
+			}
+		}
+		std::sort(uses.begin(), uses.end());
+		uses.erase(std::unique(uses.begin(), uses.end()), uses.end());
+
+		// Walk back from every use, one variable at a time.
+		unsigned numBlocks = blocks_.size();
+		liveIn_.resize(numBlocks);
+		liveOut_.resize(numBlocks);
+		liveInMark_.assign(numBlocks, 0);
+		liveOutMark_.assign(numBlocks, 0);
+		std::vector<unsigned> pending;
+		for (auto [var, inst] : uses) {
+			unsigned b = std::upper_bound(blockBegin_.begin(), blockBegin_.end(), inst) - blockBegin_.begin() - 1;
+			if (liveInMark_[b] == var + 1 || !reachesEntry(b, inst, var)) {
+				continue;
+			}
+			markLiveIn(b, var, pending);
+			while (!pending.empty()) {
+				unsigned p = pending.back();
+				pending.pop_back();
+				markLiveIn(p, var, pending);
+			}
+		}
+
+		size_t bytes = (blockBegin_.size() + blockDefsBegin_.size() + predBegin_.size() + preds_.size()) * sizeof(unsigned) +
+			(defs_.size() + blockDefs_.size()) * sizeof(int) +
+			2 * numBlocks * (sizeof(int) + sizeof(std::vector<unsigned>));
+		for (unsigned b = 0; b < numBlocks; ++b) {
+			bytes += (liveIn_[b].capacity() + liveOut_[b].capacity()) * sizeof(unsigned);
+		}
+		stats_.universe = numVars_;
+		stats_.bytesAllocated = bytes;
+		recordSolverStatistics(stats_);
+	}
+
+	bool SparseLiveness::reachesEntry(unsigned b, unsigned end, int var) {
+		stats_.blockVisits++;
+		for (unsigned i = end; i-- > blockBegin_[b];) {
+			stats_.transfers++;
+			if (defs_[i] == var) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void SparseLiveness::markLiveIn(unsigned b, int var, std::vector<unsigned>& pending) {
+		if (liveInMark_[b] == var + 1) {
+			return;
+		}
+		liveInMark_[b] = var + 1;
+		liveIn_[b].push_back(var);
+		stats_.changedBoundaries++;
+		for (unsigned i = predBegin_[b]; i < predBegin_[b + 1]; ++i) {
+			unsigned p = preds_[i];
+			if (liveOutMark_[p] == var + 1) {
+				continue;
+			}
+			liveOutMark_[p] = var + 1;
+			liveOut_[p].push_back(var);
+			stats_.meets++;
+			// var live-out of p: live-in as well unless p defines it.
+			stats_.blockVisits++;
+			if (liveInMark_[p] != var + 1 && !defines(p, var)) {
+				pending.push_back(p);
+			}
+		}
+	}
+
+	void SparseLiveness::printStats(raw_ostream& OS) const {
+		OS << "Live-in insertions: " << stats_.changedBoundaries << "\n";
+		OS << "Live-out insertions: " << stats_.meets << "\n";
+		OS << "Block walks: " << stats_.blockVisits << "\n";
+		OS << "Instructions walked: " << stats_.transfers << "\n";
+	}
+
+	ArrayRef<unsigned> SparseLiveness::liveIn(const BasicBlock* BB) const {
+		return liveIn_[blockIndex_.lookup(BB)];
+	}
+
+	ArrayRef<unsigned> SparseLiveness::liveOut(const BasicBlock* BB) const {
+		return liveOut_[blockIndex_.lookup(BB)];
+	}
+
+	BitVector SparseLiveness::liveInBits(const BasicBlock* BB) const {
+		BitVector bits(numVars_);
+		for (unsigned var : liveIn(BB)) {
+			bits.set(var);
+		}
+		return bits;
+	}
+
+	BitVector SparseLiveness::liveOutBits(const BasicBlock* BB) const {
+		BitVector bits(numVars_);
+		for (unsigned var : liveOut(BB)) {
+			bits.set(var);
+		}
+		return bits;
+	}
+}
@@ -0,0 +1,86 @@
+// 15-745 Assignment 2: sparse-liveness.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SPARSE_LIVENESS_H__
+#define __SPARSE_LIVENESS_H__
+
+#include <algorithm>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+
+#include "dataflow-metrics.h"
+#include "liveness-support.h"
+#include "phi-alias.h"
+
+namespace llvm {
+	// Liveness computed per variable from its def-use chains instead of by a dense bitvector fixpoint.
+	// For every use of a variable, walks backwards to its definitions, marking the variable live-in and
+	// live-out of the blocks on the way, so the work is proportional to the live ranges and only the
+	// live-in and live-out lists of each block are stored.
+	// Variables and their definitions and uses follow LivenessPolicy: a variable is a PHI alias set, every
+	// instruction whose representative is the variable defines it, and every operand whose representative
+	// is the variable uses it, PHI operands included. The sets are therefore identical to the block
+	// boundaries of the dense solver.
+	class SparseLiveness {
+		public:
+			// Compute the live-in and live-out lists of every block reachable from the entry of F for the
+			// variables numbered by offsetMap.
+			SparseLiveness(Function& F, const PhiAliasResolver& aliases, const LivenessDataflow::BitVectorOffsetMap& offsetMap);
+
+			// Whether BB is reachable from the entry, so it has live sets.
+			bool isReached(const BasicBlock* BB) const { return blockIndex_.count(BB); }
+			// Offsets of the variables live on entry to / on exit from a reached BB, in increasing order.
+			ArrayRef<unsigned> liveIn(const BasicBlock* BB) const;
+			ArrayRef<unsigned> liveOut(const BasicBlock* BB) const;
+			// The same as BitVectors over all variables.
+			BitVector liveInBits(const BasicBlock* BB) const;
+			BitVector liveOutBits(const BasicBlock* BB) const;
+
+			// blockVisits counts block walks, changedBoundaries live-in insertions, meets live-out insertions
+			// and transfers the instructions walked.
+			const SolverStats& getStats() const { return stats_; }
+			// Print the counters of getStats() under those names; the sparse counterpart of printSolverStats().
+			void printStats(raw_ostream& OS) const;
+
+		private:
+			// Walk block b backwards from instruction index end (exclusive) for variable var. Returns true if
+			// no definition of var was found, so var is live on entry to b.
+			bool reachesEntry(unsigned b, unsigned end, int var);
+			// Whether block b defines var anywhere.
+			bool defines(unsigned b, int var) const {
+				auto begin = blockDefs_.begin() + blockDefsBegin_[b], end = blockDefs_.begin() + blockDefsBegin_[b + 1];
+				return std::binary_search(begin, end, var);
+			}
+			// Mark var live-in of block b and propagate it to the live-out of the predecessors, walking
+			// each predecessor that did not already have it.
+			void markLiveIn(unsigned b, int var, std::vector<unsigned>& pending);
+
+			unsigned numVars_;
+			DenseMap<const BasicBlock*, unsigned> blockIndex_;
+			std::vector<const BasicBlock*> blocks_;
+			// Instructions of block b are numbered blockBegin_[b] .. blockBegin_[b + 1] - 1 in program order.
+			std::vector<unsigned> blockBegin_;
+			// Variable defined by each instruction, or -1.
+			std::vector<int> defs_;
+			// blockDefs_[blockDefsBegin_[b] .. blockDefsBegin_[b + 1]) are the variables defined in block b,
+			// sorted, so a walk through a whole block is a binary search.
+			std::vector<unsigned> blockDefsBegin_;
+			std::vector<int> blockDefs_;
+			// preds_[predBegin_[b] .. predBegin_[b + 1]) are the reached predecessors of block b.
+			std::vector<unsigned> predBegin_;
+			std::vector<unsigned> preds_;
+			std::vector<std::vector<unsigned>> liveIn_;
+			std::vector<std::vector<unsigned>> liveOut_;
+			// liveInMark_[b] == var + 1 if var is already live-in of b; variables are processed in order.
+			std::vector<int> liveInMark_;
+			std::vector<int> liveOutMark_;
+			SolverStats stats_;
+	};
+}
+
+#endif
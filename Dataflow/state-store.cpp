@@ -0,0 +1,395 @@
+// 15-745 Assignment 2: state-store.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+
+#include "llvm/ADT/SmallVector.h"
+
+#include "state-store.h"
+
+namespace llvm {
+	StateRef::Word StateRef::word(unsigned w) const {
+		assert(w < numWords());
+		if (isDense()) {
+			return data_[w];
+		}
+		// Binary search for the chunk of word w.
+		unsigned lo = 0, hi = count_;
+		while (lo < hi) {
+			unsigned mid = (lo + hi) / 2;
+			if (chunkIndex(mid) < w) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		if (lo < count_ && chunkIndex(lo) == w) {
+			return chunkBits(lo);
+		}
+		return kind_ == StateKind::Sparse ? Word(0) : fullWord(w);
+	}
+
+	void StateRef::copyTo(Word* dst) const {
+		unsigned n = numWords();
+		if (n == 0) {
+			return;
+		}
+		switch (kind_) {
+			case StateKind::Dense:
+				std::memcpy(dst, data_, n * sizeof(Word));
+				return;
+			case StateKind::Sparse:
+				std::fill(dst, dst + n, Word(0));
+				break;
+			case StateKind::Complement:
+				std::fill(dst, dst + n, ~Word(0));
+				dst[n - 1] = fullWord(n - 1);
+				break;
+		}
+		for (unsigned c = 0; c < count_; ++c) {
+			dst[chunkIndex(c)] = chunkBits(c);
+		}
+	}
+
+	void StateRef::orInto(Word* dst) const {
+		switch (kind_) {
+			case StateKind::Dense:
+				bitkernels::orInto(dst, data_, numWords());
+				return;
+			case StateKind::Sparse:
+				for (unsigned c = 0; c < count_; ++c) {
+					dst[chunkIndex(c)] |= chunkBits(c);
+				}
+				return;
+			case StateKind::Complement:
+				forEachWord([&](unsigned w, Word bits) { dst[w] |= bits; });
+				return;
+		}
+	}
+
+	void StateRef::andInto(Word* dst) const {
+		switch (kind_) {
+			case StateKind::Dense:
+				bitkernels::andInto(dst, data_, numWords());
+				return;
+			case StateKind::Sparse:
+				forEachWord([&](unsigned w, Word bits) { dst[w] &= bits; });
+				return;
+			case StateKind::Complement:
+				for (unsigned c = 0; c < count_; ++c) {
+					dst[chunkIndex(c)] &= chunkBits(c);
+				}
+				return;
+		}
+	}
+
+	bool StateRef::equals(const Word* words) const {
+		if (isDense()) {
+			return numWords() == 0 || std::memcmp(data_, words, numWords() * sizeof(Word)) == 0;
+		}
+		bool same = true;
+		forEachWord([&](unsigned w, Word bits) { same &= words[w] == bits; });
+		return same;
+	}
+
+	// Apply the sparse and complemented inputs one by one, then all dense inputs in one kernel call.
+	template <class ApplyOne, class ApplyDense>
+	static void meetMixed(BitVector& state, ArrayRef<StateRef> inputs, ApplyOne applyOne, ApplyDense applyDense) {
+		if (state.size() == 0) {
+			return;
+		}
+		SmallVector<const bitkernels::Word*, 4> dense;
+		for (const StateRef& input : inputs) {
+			assert(input.size() == state.size());
+			if (input.isDense()) {
+				dense.push_back(input.words());
+			} else {
+				applyOne(input, bitkernels::words(state));
+			}
+		}
+		if (!dense.empty()) {
+			applyDense(bitkernels::words(state), dense.data(), dense.size(), bitkernels::numWords(state));
+		}
+	}
+
+	void meetUnion(BitVector& state, ArrayRef<StateRef> inputs) {
+		meetMixed(state, inputs, [](const StateRef& input, bitkernels::Word* dst) { input.orInto(dst); },
+			[](bitkernels::Word* dst, const bitkernels::Word* const* srcs, size_t count, size_t n) {
+				bitkernels::meetUnion(dst, srcs, count, n);
+			});
+	}
+
+	void meetIntersection(BitVector& state, ArrayRef<StateRef> inputs) {
+		meetMixed(state, inputs, [](const StateRef& input, bitkernels::Word* dst) { input.andInto(dst); },
+			[](bitkernels::Word* dst, const bitkernels::Word* const* srcs, size_t count, size_t n) {
+				bitkernels::meetIntersection(dst, srcs, count, n);
+			});
+	}
+
+	void StateStore::allocate(ArrayRef<BasicBlock*> blocks, unsigned numElements, bool forward,
+		function_ref<bool(Instruction&, unsigned)> keepInstruction, StateRepresentation representation) {
+		release();
+		representation_ = representation;
+		numElements_ = numElements;
+		stride_ = (numElements + bitkernels::WordBits - 1) / bitkernels::WordBits;
+		blocks_.assign(blocks.begin(), blocks.end());
+		blockIndex_.reserve(blocks_.size());
+		for (unsigned i = 0; i < blocks_.size(); ++i) {
+			blockIndex_[blocks_[i]] = i;
+		}
+		for (BasicBlock* BB : blocks_) {
+			unsigned index = 0;
+			auto visit = [&](Instruction& I) {
+				if (keepInstruction(I, ++index)) {
+					instructionIndex_[&I] = instructions_.size();
+					instructions_.push_back(&I);
+				}
+			};
+			if (forward) {
+				for (Instruction& I : *BB) visit(I);
+			} else {
+				for (auto it = BB->rbegin(); it != BB->rend(); ++it) visit(*it);
+			}
+		}
+		numRows_ = 2 * blocks_.size() + instructions_.size();
+		if (representation_ == StateRepresentation::Adaptive) {
+			// An empty sparse row needs no words.
+			rows_.resize(numRows_);
+		} else if (representation_ == StateRepresentation::Interned) {
+			interned_.assign(numRows_, nullptr);
+			std::vector<Word> empty(stride_);
+			for (unsigned r = 0; r < numRows_ && stride_ != 0; ++r) {
+				setInterned(r, empty.data());
+			}
+		} else if (numRows_ * stride_ != 0) {
+			slab_.reset(new Word[numRows_ * stride_]());
+		}
+	}
+
+	void StateStore::release() {
+		slab_.reset();
+		rows_.clear();
+		rows_.shrink_to_fit();
+		adaptiveWords_ = 0;
+		interned_.clear();
+		interned_.shrink_to_fit();
+		pool_.clear();
+		free_.clear();
+		poolAllocator_.Reset();
+		representation_ = StateRepresentation::Dense;
+		numElements_ = 0;
+		stride_ = 0;
+		numRows_ = 0;
+		blocks_.clear();
+		instructions_.clear();
+		blockIndex_.clear();
+		instructionIndex_.clear();
+	}
+
+	size_t StateStore::bytesAllocated() const {
+		if (representation_ == StateRepresentation::Adaptive) {
+			return rows_.size() * sizeof(AdaptiveRow) + adaptiveWords_ * sizeof(Word);
+		}
+		if (representation_ == StateRepresentation::Interned) {
+			return interned_.size() * sizeof(Word*) + pool_.getMemorySize() + poolAllocator_.getBytesAllocated();
+		}
+		return numRows_ * stride_ * sizeof(Word);
+	}
+
+	unsigned StateStore::numRows(StateKind kind) const {
+		if (representation_ != StateRepresentation::Adaptive) {
+			return kind == StateKind::Dense ? numRows_ : 0;
+		}
+		return std::count_if(rows_.begin(), rows_.end(), [&](const AdaptiveRow& row) { return row.kind == kind; });
+	}
+
+	unsigned StateStore::numUniqueStates() const {
+		if (representation_ != StateRepresentation::Interned) {
+			return numRows_;
+		}
+		return pool_.size();
+	}
+
+	StateRef StateStore::state(unsigned r) const {
+		assert(r < numRows_);
+		if (representation_ == StateRepresentation::Dense) {
+			return StateRef(slabRow(r), numElements_);
+		}
+		if (representation_ == StateRepresentation::Interned) {
+			return StateRef(interned_[r], numElements_);
+		}
+		const AdaptiveRow& row = rows_[r];
+		return StateRef(row.kind, row.data.get(), row.count, numElements_);
+	}
+
+	void StateStore::load(unsigned row, BitVector& dst) const {
+		if (dst.size() != numElements_) {
+			dst.resize(numElements_);
+		}
+		if (stride_ != 0) {
+			state(row).copyTo(bitkernels::words(dst));
+		}
+	}
+
+	void StateStore::store(unsigned row, const BitVector& src) {
+		assert(src.size() == numElements_);
+		if (stride_ == 0) {
+			return;
+		}
+		if (representation_ == StateRepresentation::Adaptive) {
+			storeAdaptive(row, bitkernels::words(src));
+		} else if (representation_ == StateRepresentation::Interned) {
+			setInterned(row, bitkernels::words(src));
+		} else {
+			std::memcpy(slabRow(row), bitkernels::words(src), stride_ * sizeof(Word));
+		}
+	}
+
+	bool StateStore::storeIfChanged(unsigned row, const BitVector& src) {
+		assert(src.size() == numElements_);
+		if (stride_ == 0) {
+			return false;
+		}
+		if (representation_ == StateRepresentation::Interned) {
+			return setInterned(row, bitkernels::words(src));
+		}
+		if (state(row).equals(bitkernels::words(src))) {
+			return false;
+		}
+		store(row, src);
+		return true;
+	}
+
+	void StateStore::fill(unsigned row, bool value) {
+		if (stride_ == 0) {
+			return;
+		}
+		if (representation_ == StateRepresentation::Adaptive) {
+			AdaptiveRow& r = rows_[row];
+			reserve(r, 0);
+			r.kind = value ? StateKind::Complement : StateKind::Sparse;
+			r.count = 0;
+			return;
+		}
+		if (representation_ == StateRepresentation::Interned) {
+			BitVector filled(numElements_, value);
+			setInterned(row, bitkernels::words(filled));
+			return;
+		}
+		Word* dst = slabRow(row);
+		std::fill(dst, dst + stride_, value ? ~Word(0) : Word(0));
+		unsigned tailBits = numElements_ % bitkernels::WordBits;
+		if (value && tailBits != 0) {
+			dst[stride_ - 1] = (Word(1) << tailBits) - 1;
+		}
+	}
+
+	void StateStore::copyRow(unsigned row, const StateStore& from, unsigned fromRow) {
+		assert(from.numElements_ == numElements_);
+		if (stride_ == 0) {
+			return;
+		}
+		if (representation_ == StateRepresentation::Dense) {
+			from.state(fromRow).copyTo(slabRow(row));
+			return;
+		}
+		if (representation_ == StateRepresentation::Interned) {
+			BitVector copy = from.state(fromRow).toBitVector();
+			setInterned(row, bitkernels::words(copy));
+			return;
+		}
+		if (from.representation_ == StateRepresentation::Dense) {
+			storeAdaptive(row, from.slabRow(fromRow));
+			return;
+		}
+		const AdaptiveRow& src = from.rows_[fromRow];
+		AdaptiveRow& dst = rows_[row];
+		unsigned numWords = src.kind == StateKind::Dense ? src.count : 2 * src.count;
+		Word* data = reserve(dst, numWords);
+		if (numWords != 0) {
+			std::memcpy(data, src.data.get(), numWords * sizeof(Word));
+		}
+		dst.kind = src.kind;
+		dst.count = src.count;
+	}
+
+	StateStore::Word* StateStore::reserve(AdaptiveRow& row, unsigned numWords) {
+		// Shrink rows that became much sparser, so bytesAllocated() follows the states.
+		if (numWords > row.capacity || numWords * SparseDensityDivisor < row.capacity) {
+			adaptiveWords_ -= row.capacity;
+			row.data.reset(numWords == 0 ? nullptr : new Word[numWords]);
+			row.capacity = numWords;
+			adaptiveWords_ += numWords;
+		}
+		return row.data.get();
+	}
+
+	void StateStore::storeAdaptive(unsigned r, const Word* src) {
+		// The universal set, for fullWord().
+		StateRef universe(StateKind::Complement, nullptr, 0, numElements_);
+		unsigned nonZero = 0, notFull = 0;
+		for (unsigned w = 0; w < stride_; ++w) {
+			nonZero += src[w] != 0;
+			notFull += src[w] != universe.fullWord(w);
+		}
+		AdaptiveRow& row = rows_[r];
+		// Keep the words that differ from the implicit value of kind as chunks.
+		auto encode = [&](StateKind kind, unsigned count) {
+			Word* data = reserve(row, 2 * count);
+			for (unsigned w = 0; w < stride_; ++w) {
+				Word implicit = kind == StateKind::Sparse ? Word(0) : universe.fullWord(w);
+				if (src[w] != implicit) {
+					*data++ = w;
+					*data++ = src[w];
+				}
+			}
+			row.kind = kind;
+			row.count = count;
+		};
+		if (nonZero * SparseDensityDivisor <= stride_) {
+			encode(StateKind::Sparse, nonZero);
+		} else if (notFull * SparseDensityDivisor <= stride_) {
+			encode(StateKind::Complement, notFull);
+		} else {
+			Word* data = reserve(row, stride_);
+			std::memcpy(data, src, stride_ * sizeof(Word));
+			row.kind = StateKind::Dense;
+			row.count = stride_;
+		}
+	}
+
+	bool StateStore::setInterned(unsigned row, const Word* words) {
+		// Hash-cons the candidate first: equal states share one pooled copy, so the row is unchanged exactly
+		// when the pool returns the copy it already points to.
+		Word* current = interned_[row];
+		auto it = pool_.find(ArrayRef<Word>(words, stride_));
+		if (it != pool_.end() && it->data() == current) {
+			return false;
+		}
+		Word* pooled;
+		if (it != pool_.end()) {
+			pooled = const_cast<Word*>(it->data());
+		} else {
+			// Every pooled state is stride_ words after its reference count, so freed ones are reused as is.
+			Word* block;
+			if (!free_.empty()) {
+				block = free_.back();
+				free_.pop_back();
+			} else {
+				block = poolAllocator_.Allocate<Word>(stride_ + 1);
+			}
+			block[0] = 0;
+			pooled = block + 1;
+			std::copy(words, words + stride_, pooled);
+			pool_.insert(ArrayRef<Word>(pooled, stride_));
+		}
+		pooled[-1]++;
+		if (current && --current[-1] == 0) {
+			pool_.erase(ArrayRef<Word>(current, stride_));
+			free_.push_back(current - 1);
+		}
+		interned_[row] = pooled;
+		return true;
+	}
+}
@@ -0,0 +1,266 @@
+// 15-745 Assignment 2: state-store.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __STATE_STORE_H__
+#define __STATE_STORE_H__
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/Allocator.h"
+#include "llvm/Support/MathExtras.h"
+
+#include "bitset-kernels.h"
+
+namespace llvm {
+	// Encoding of one stored state.
+	enum class StateKind : uint8_t {
+		// One word per word of the universe.
+		Dense,
+		// Chunks (word index, word) of the non-zero words, by increasing index. Every other word is zero.
+		Sparse,
+		// Chunks (word index, word) of the words that are not full, by increasing index. Every other word
+		// has all its bits set: a near-universal set stored by its few missing elements.
+		Complement
+	};
+
+	// How a StateStore keeps its rows.
+	enum class StateRepresentation {
+		// Every row is a dense row of one 2D slab.
+		Dense,
+		// Every row picks its StateKind by density whenever it is stored.
+		Adaptive,
+		// Every row refers to an immutable dense state in a hash-consed pool, so equal states are stored
+		// once and two rows hold equal states exactly when they point to the same pooled state.
+		Interned
+	};
+
+	// Read-only view of one state row of a StateStore, in any StateKind.
+	class StateRef {
+		public:
+			using Word = bitkernels::Word;
+
+			// Dense view of numWords(size) words.
+			StateRef(const Word* words, unsigned size) : StateRef(StateKind::Dense, words, 0, size) {}
+			// Sparse or complemented view of count chunks, stored as 2 * count words (index, bits).
+			StateRef(StateKind kind, const Word* data, unsigned count, unsigned size)
+				: data_(data), count_(count), size_(size), kind_(kind) {}
+
+			StateKind kind() const { return kind_; }
+			bool isDense() const { return kind_ == StateKind::Dense; }
+			unsigned size() const { return size_; }
+			unsigned numWords() const { return (size_ + bitkernels::WordBits - 1) / bitkernels::WordBits; }
+			// Words of a dense view.
+			const Word* words() const {
+				assert(isDense());
+				return data_;
+			}
+			// Chunks of a sparse or complemented view.
+			unsigned numChunks() const { return isDense() ? 0 : count_; }
+			unsigned chunkIndex(unsigned c) const { return data_[2 * c]; }
+			Word chunkBits(unsigned c) const { return data_[2 * c + 1]; }
+
+			// Word w with all the bits that belong to the universe set.
+			Word fullWord(unsigned w) const {
+				unsigned tailBits = size_ % bitkernels::WordBits;
+				return w + 1 == numWords() && tailBits != 0 ? (Word(1) << tailBits) - 1 : ~Word(0);
+			}
+
+			// Value of word w.
+			Word word(unsigned w) const;
+
+			bool test(unsigned i) const {
+				assert(i < size_);
+				return (word(i / bitkernels::WordBits) >> (i % bitkernels::WordBits)) & 1;
+			}
+
+			// Call f(i) for every set bit i, in increasing order.
+			template <class Callback>
+			void forEachSetBit(Callback&& f) const {
+				auto visit = [&](unsigned w, Word bits) {
+					for (; bits != 0; bits &= bits - 1) {
+						f(w * bitkernels::WordBits + countTrailingZeros(bits));
+					}
+				};
+				if (kind_ == StateKind::Sparse) {
+					for (unsigned c = 0; c < count_; ++c) visit(chunkIndex(c), chunkBits(c));
+				} else {
+					for (unsigned w = 0; w < numWords(); ++w) visit(w, word(w));
+				}
+			}
+
+			// Write all numWords() words to dst.
+			void copyTo(Word* dst) const;
+			// dst |= this, dst &= this.
+			void orInto(Word* dst) const;
+			void andInto(Word* dst) const;
+			// Whether the numWords() words at words hold the same set.
+			bool equals(const Word* words) const;
+
+			BitVector toBitVector() const {
+				BitVector result(size_);
+				if (size_ != 0) {
+					copyTo(bitkernels::words(result));
+				}
+				return result;
+			}
+
+		private:
+			// Call f(w, bits) for every word of a sparse or complemented view, chunk or implicit.
+			template <class Callback>
+			void forEachWord(Callback&& f) const {
+				unsigned c = 0;
+				for (unsigned w = 0; w < numWords(); ++w) {
+					if (c < count_ && chunkIndex(c) == w) {
+						f(w, chunkBits(c++));
+					} else {
+						f(w, kind_ == StateKind::Sparse ? Word(0) : fullWord(w));
+					}
+				}
+			}
+
+			const Word* data_;
+			unsigned count_;
+			unsigned size_;
+			StateKind kind_;
+	};
+
+	// state = state ∪ inputs[0] ∪ ... and state = state ∩ inputs[0] ∩ ..., for inputs in any StateKind.
+	// Dense inputs go through one n-ary bitset kernel call, the others are applied chunk by chunk.
+	void meetUnion(BitVector& state, ArrayRef<StateRef> inputs);
+	void meetIntersection(BitVector& state, ArrayRef<StateRef> inputs);
+
+	// Analysis states of one function.
+	// Reached blocks are numbered densely in the order given to allocate(), and every block owns two rows:
+	// its boundary (forward: OUT, backward: IN) and its input (the meet of its neighbours' boundaries).
+	// Instructions selected by allocate() get one more row each, numbered densely in block order.
+	// Rows are addressed by the numbers boundaryRow(), inputRow() and instructionRow() return.
+	// With StateRepresentation::Dense all rows live in one zero-initialized slab, stride() words each.
+	// With StateRepresentation::Adaptive each row is stored as a Sparse, Complement or Dense StateKind,
+	// chosen from its density every time it is written, so the mostly empty states of liveness and the
+	// mostly full states of available expressions only cost their few exceptions.
+	// With StateRepresentation::Interned each row points to a state of a hash-consed pool. An instruction that
+	// neither gens nor kills shares the state of its neighbour. States are reference counted: a state no row
+	// refers to any more leaves the pool and its block is reused.
+	// All rows start empty.
+	class StateStore {
+		public:
+			using Word = bitkernels::Word;
+
+			// An adaptive row is kept sparse (complemented) when at most 1 / SparseDensityDivisor of its words
+			// are non-zero (not full). A chunk takes two words, so such a row takes at most half of a dense one.
+			static constexpr unsigned SparseDensityDivisor = 4;
+
+			StateStore() = default;
+			StateStore(StateStore&&) = default;
+			StateStore& operator=(StateStore&&) = default;
+
+			// Number blocks and the instructions for which keepInstruction(I, indexInBlock) returns true, and
+			// allocate all rows, initialized to the empty set. indexInBlock counts from 1 in the order given
+			// by forward. Any previous contents are released.
+			void allocate(ArrayRef<BasicBlock*> blocks, unsigned numElements, bool forward,
+				function_ref<bool(Instruction&, unsigned)> keepInstruction,
+				StateRepresentation representation = StateRepresentation::Dense);
+
+			// Free all rows and the numbering.
+			void release();
+
+			StateRepresentation representation() const { return representation_; }
+			unsigned numElements() const { return numElements_; }
+			unsigned stride() const { return stride_; }
+			unsigned numBlocks() const { return blocks_.size(); }
+			unsigned numInstructions() const { return instructions_.size(); }
+			unsigned numRows() const { return numRows_; }
+			// Bytes held by the rows.
+			size_t bytesAllocated() const;
+			// Number of rows currently stored as kind. Every row of a dense or interned store is Dense.
+			unsigned numRows(StateKind kind) const;
+			// Number of distinct states the rows of an interned store refer to, or numRows() for the other
+			// representations.
+			unsigned numUniqueStates() const;
+
+			// Blocks and instructions with a row, in index order.
+			ArrayRef<BasicBlock*> blocks() const { return blocks_; }
+			ArrayRef<Instruction*> instructions() const { return instructions_; }
+
+			// Dense index of BB / I, or -1 if it has no row.
+			int blockIndex(const BasicBlock* BB) const {
+				auto it = blockIndex_.find(BB);
+				return it == blockIndex_.end() ? -1 : (int)it->second;
+			}
+			int instructionIndex(const Instruction* I) const {
+				auto it = instructionIndex_.find(I);
+				return it == instructionIndex_.end() ? -1 : (int)it->second;
+			}
+
+			unsigned boundaryRow(unsigned block) const { return block; }
+			unsigned inputRow(unsigned block) const { return blocks_.size() + block; }
+			unsigned instructionRow(unsigned inst) const { return 2 * blocks_.size() + inst; }
+
+			StateRef state(unsigned row) const;
+			StateRef boundaryState(unsigned block) const { return state(boundaryRow(block)); }
+			StateRef inputState(unsigned block) const { return state(inputRow(block)); }
+			StateRef instructionState(unsigned inst) const { return state(instructionRow(inst)); }
+
+			// Copy a row into / out of a BitVector of numElements() bits.
+			void load(unsigned row, BitVector& dst) const;
+			void store(unsigned row, const BitVector& src);
+			// Store src unless the row already holds it. Returns true if the row changed.
+			bool storeIfChanged(unsigned row, const BitVector& src);
+			// Set every bit of a row to value.
+			void fill(unsigned row, bool value);
+			// Copy row fromRow of from, a store with the same numElements(), into row.
+			void copyRow(unsigned row, const StateStore& from, unsigned fromRow);
+
+		private:
+			struct AdaptiveRow {
+				// Dense: count words. Sparse, Complement: count chunks of two words (index, bits).
+				std::unique_ptr<Word[]> data;
+				unsigned count = 0;
+				unsigned capacity = 0;
+				StateKind kind = StateKind::Sparse;
+			};
+
+			Word* slabRow(unsigned r) { return slab_.get() + (size_t)r * stride_; }
+			const Word* slabRow(unsigned r) const { return slab_.get() + (size_t)r * stride_; }
+			// Encode the stride_ words at src into row r of an adaptive store.
+			void storeAdaptive(unsigned r, const Word* src);
+			// Make room for numWords words in row r, keeping capacity close to the need.
+			Word* reserve(AdaptiveRow& row, unsigned numWords);
+			// Point row at the pooled copy of the stride_ words at words, adding it to the pool if it is new,
+			// and drop the state the row referred to once no row refers to it. Returns true if the row changed,
+			// which is a pointer comparison with the pooled copy.
+			bool setInterned(unsigned row, const Word* words);
+
+			StateRepresentation representation_ = StateRepresentation::Dense;
+			unsigned numElements_ = 0;
+			unsigned stride_ = 0;
+			size_t numRows_ = 0;
+			std::unique_ptr<Word[]> slab_;
+			std::vector<AdaptiveRow> rows_;
+			// Words held by rows_.
+			size_t adaptiveWords_ = 0;
+			// Interned: the pooled state of every row, the pool of the distinct states the rows refer to, and
+			// the freed pool blocks. Each pooled state is preceded by the number of rows referring to it.
+			std::vector<Word*> interned_;
+			DenseSet<ArrayRef<Word>> pool_;
+			std::vector<Word*> free_;
+			BumpPtrAllocator poolAllocator_;
+			std::vector<BasicBlock*> blocks_;
+			std::vector<Instruction*> instructions_;
+			DenseMap<const BasicBlock*, unsigned> blockIndex_;
+			DenseMap<const Instruction*, unsigned> instructionIndex_;
+	};
+}
+
+#endif
@@ -0,0 +1,114 @@
+// 15-745 Assignment 2: weak-topological-order.cpp
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <climits>
+
+#include "weak-topological-order.h"
+
+namespace llvm {
+	// Bourdoncle's recursive visit() and component(), with the call stack kept in frames. The partition
+	// is built by prepending, so it is written back to front into reversed and flipped at the end.
+	WeakTopologicalOrder::WeakTopologicalOrder(ArrayRef<unsigned> begin, ArrayRef<int> succ,
+		ArrayRef<unsigned> roots) {
+		unsigned numNodes = begin.size() - 1;
+		const unsigned Done = UINT_MAX;
+		std::vector<unsigned> dfn(numNodes, 0);
+		std::vector<unsigned> stack;
+		std::vector<unsigned> reversed;
+		// Length of the component headed by each node, indexed by its position in reversed.
+		std::vector<unsigned> reversedLength;
+		unsigned num = 0;
+
+		struct Frame {
+			unsigned v;
+			// Next successor to look at.
+			unsigned next;
+			unsigned head;
+			bool loop;
+			// visit() finished and found a component headed by v; now visiting its body.
+			bool component;
+			// Size of reversed when the component body started.
+			size_t start;
+		};
+		std::vector<Frame> frames;
+		auto enter = [&](unsigned v) {
+			stack.push_back(v);
+			dfn[v] = ++num;
+			frames.push_back({v, begin[v], dfn[v], false, false, 0});
+		};
+		auto emit = [&](unsigned v, unsigned length) {
+			reversed.push_back(v);
+			reversedLength.push_back(length);
+		};
+
+		auto run = [&]() {
+			while (!frames.empty()) {
+				Frame& f = frames.back();
+				if (f.next < begin[f.v + 1]) {
+					int w = succ[f.next++];
+					if (w < 0) {
+						continue;
+					}
+					if (dfn[w] == 0) {
+						enter(w);
+					} else if (!f.component && dfn[w] <= f.head) {
+						f.head = dfn[w];
+						f.loop = true;
+					}
+					continue;
+				}
+				if (f.component) {
+					emit(f.v, reversed.size() - f.start + 1);
+					numComponents_++;
+				} else if (f.head == dfn[f.v]) {
+					dfn[f.v] = Done;
+					unsigned e = stack.back();
+					stack.pop_back();
+					if (f.loop) {
+						while (e != f.v) {
+							dfn[e] = 0;
+							e = stack.back();
+							stack.pop_back();
+						}
+						f.component = true;
+						f.next = begin[f.v];
+						f.start = reversed.size();
+						continue;
+					}
+					emit(f.v, 0);
+				}
+				unsigned head = f.head;
+				frames.pop_back();
+				// Return head to the visit() that called us; component() ignores it.
+				if (!frames.empty() && !frames.back().component && head <= frames.back().head) {
+					frames.back().head = head;
+					frames.back().loop = true;
+				}
+			}
+		};
+
+		for (unsigned root : roots) {
+			if (dfn[root] == 0) {
+				enter(root);
+				run();
+			}
+		}
+		for (unsigned v = 0; v < numNodes; ++v) {
+			if (dfn[v] == 0) {
+				enter(v);
+				run();
+			}
+		}
+
+		order_.assign(reversed.rbegin(), reversed.rend());
+		componentEnd_.assign(numNodes, 0);
+		for (unsigned i = 0; i < reversed.size(); ++i) {
+			if (reversedLength[i] != 0) {
+				unsigned pos = numNodes - 1 - i;
+				componentEnd_[pos] = pos + reversedLength[i];
+			}
+		}
+	}
+}
@@ -0,0 +1,39 @@
+// 15-745 Assignment 2: weak-topological-order.h
+// Group: Haojia Sun (haojias), Yikang Cai (dcai)
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __WEAK_TOPOLOGICAL_ORDER_H__
+#define __WEAK_TOPOLOGICAL_ORDER_H__
+
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace llvm {
+	// Weak topological order of a directed graph (Bourdoncle, "Efficient chaotic iteration strategies with
+	// widenings", 1993): a topological order of the nodes in which every strongly connected part is a
+	// nested component, listed as its head followed by the rest of its body. Iterating each component until
+	// its head is stable, innermost first, stabilizes inner loops before their enclosing loops. Irreducible
+	// cycles simply become components headed by the node the depth-first search entered them through.
+	class WeakTopologicalOrder {
+		public:
+			// Order the nodes 0 .. begin.size() - 2, whose successors are succ[begin[v] .. begin[v + 1]).
+			// Negative successors are ignored. The depth-first search starts from roots, in order, and then
+			// from every node not reached yet, in index order, so every node is ordered. Iterative, so deep
+			// graphs do not overflow the stack.
+			WeakTopologicalOrder(ArrayRef<unsigned> begin, ArrayRef<int> succ, ArrayRef<unsigned> roots);
+
+			// All nodes, heads before their components' bodies.
+			ArrayRef<unsigned> order() const { return order_; }
+			// If order()[pos] heads a component, the position one past the end of the component, else 0.
+			unsigned componentEnd(unsigned pos) const { return componentEnd_[pos]; }
+			unsigned numComponents() const { return numComponents_; }
+
+		private:
+			std::vector<unsigned> order_;
+			std::vector<unsigned> componentEnd_;
+			unsigned numComponents_ = 0;
+	};
+}
+
+#endif
@@ -0,0 +1,35 @@
+; ModuleID = '../tests/liveness-test-m2r.bc'
+source_filename = "tmp.c"
+target datalayout = "e-m:e-p:32:32-p270:32:32-p271:32:32-p272:64:64-f64:32:64-f80:32-n8:16:32-S128"
+target triple = "i686-pc-linux-gnu"
+
+; Function Attrs: noinline nounwind
+define dso_local i32 @sum(i32 %0, i32 %1) #0 {
+  br label %3
+
+3:                                                ; preds = %7, %2
+  %.01 = phi i32 [ 1, %2 ], [ %6, %7 ]
+  %.0 = phi i32 [ %0, %2 ], [ %8, %7 ]
+  %4 = icmp slt i32 %.0, %1
+  br i1 %4, label %5, label %9
+
+5:                                                ; preds = %3
+  %6 = mul nsw i32 %.01, %.0
+  br label %7
+
+7:                                                ; preds = %5
+  %8 = add nsw i32 %.0, 1
+  br label %3
+
+9:                                                ; preds = %3
+  ret i32 %.01
+}
+
+attributes #0 = { noinline nounwind "correctly-rounded-divide-sqrt-fp-math"="false" "disable-tail-calls"="false" "frame-pointer"="all" "less-precise-fpmad"="false" "min-legal-vector-width"="0" "no-infs-fp-math"="false" "no-jump-tables"="false" "no-nans-fp-math"="false" "no-signed-zeros-fp-math"="false" "no-trapping-math"="false" "stack-protector-buffer-size"="8" "target-cpu"="pentium4" "target-features"="+cx8,+fxsr,+mmx,+sse,+sse2,+x87" "unsafe-fp-math"="false" "use-soft-float"="false" }
+
+!llvm.module.flags = !{!0, !1}
+!llvm.ident = !{!2}
+
+!0 = !{i32 1, !"NumRegisterParameters", i32 0}
+!1 = !{i32 1, !"wchar_size", i32 4}
+!2 = !{!"clang version 10.0.0 (https://github.com/llvm/llvm-project.git 1cc8fff420a76ae869f73ce2b19e7c1fc73da3ed)"}
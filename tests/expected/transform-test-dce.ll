@@ -0,0 +1,51 @@
+; ModuleID = '../tests/transform-test.ll'
+source_filename = "../tests/transform-test.ll"
+
+define i32 @dead(i32 %n, i32 %a) {
+entry:
+  br label %loop
+
+loop:                                             ; preds = %loop, %entry
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = add i32 %acc, %i
+  %next = add i32 %i, 1
+  %cmp = icmp slt i32 %next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:                                             ; preds = %loop
+  ret i32 %acc.next
+}
+
+define i32 @redundant(i32 %a, i32 %b, i1 %c) {
+entry:
+  %x = add i32 %a, %b
+  br i1 %c, label %left, label %right
+
+left:                                             ; preds = %entry
+  %y = add i32 %a, %b
+  %l = mul i32 %y, %x
+  br label %join
+
+right:                                            ; preds = %entry
+  %z = add i32 %a, %b
+  %r = sub i32 %z, 1
+  br label %join
+
+join:                                             ; preds = %right, %left
+  %p = phi i32 [ %l, %left ], [ %r, %right ]
+  %w = add i32 %a, %b
+  %s = add i32 %p, %w
+  ret i32 %s
+}
+
+define i32 @main() {
+entry:
+  %d = call i32 @dead(i32 10, i32 3)
+  %r1 = call i32 @redundant(i32 4, i32 5, i1 true)
+  %r2 = call i32 @redundant(i32 4, i32 5, i1 false)
+  %s1 = add i32 %d, %r1
+  %s2 = add i32 %s1, %r2
+  %code = urem i32 %s2, 256
+  ret i32 %code
+}
@@ -0,0 +1,54 @@
+; Input for the before/after checks of -liveness-dce and -available-elim in make check.
+define i32 @dead(i32 %n, i32 %a) {
+entry:
+  %unused = mul i32 %a, 7
+  br label %loop
+
+loop:
+  %i = phi i32 [ 0, %entry ], [ %next, %loop ]
+  %acc = phi i32 [ 0, %entry ], [ %acc.next, %loop ]
+  %acc.next = add i32 %acc, %i
+  %t = add i32 %unused, %i
+  %next = add i32 %i, 1
+  %cmp = icmp slt i32 %next, %n
+  br i1 %cmp, label %loop, label %exit
+
+exit:
+  %lcssa = phi i32 [ %t, %loop ]
+  %chain = shl i32 %lcssa, 2
+  ret i32 %acc.next
+}
+
+define i32 @redundant(i32 %a, i32 %b, i1 %c) {
+entry:
+  %x = add i32 %a, %b
+  br i1 %c, label %left, label %right
+
+left:
+  %y = add i32 %a, %b
+  %l = mul i32 %y, %x
+  br label %join
+
+right:
+  %z = add i32 %a, %b
+  %r = sub i32 %z, 1
+  br label %join
+
+join:
+  %p = phi i32 [ %l, %left ], [ %r, %right ]
+  %w = add i32 %a, %b
+  %s = add i32 %p, %w
+  ret i32 %s
+}
+
+; The exit code of lli must not change under either transform.
+define i32 @main() {
+entry:
+  %d = call i32 @dead(i32 10, i32 3)
+  %r1 = call i32 @redundant(i32 4, i32 5, i1 true)
+  %r2 = call i32 @redundant(i32 4, i32 5, i1 false)
+  %s1 = add i32 %d, %r1
+  %s2 = add i32 %s1, %r2
+  %code = urem i32 %s2, 256
+  ret i32 %code
+}